@@ -0,0 +1,22 @@
+#include "abstractviewfilter.h"
+#include "roiprojectiondata.h"
+#include "threadpool.h"
+
+#include "img/projectiondata.h"
+
+void AbstractViewFilter::filter(CTL::ProjectionData& projections)
+{
+    ThreadPool::instance().run(projections.dimensions().nbViews, [&] (size_t view) {
+        filterView(projections.data()[view]);
+    });
+}
+
+void AbstractViewFilter::filterRoi(RoiProjectionData& projections)
+{
+    ThreadPool::instance().run(projections.nbViews(), [&] (size_t i) {
+        const auto view = static_cast<uint>(i);
+        auto fullView = projections.view(view);
+        filterView(fullView);
+        projections.setView(view, fullView);
+    });
+}
@@ -0,0 +1,28 @@
+#ifndef ABSTRACTVIEWFILTER_H
+#define ABSTRACTVIEWFILTER_H
+
+#include "img/singleviewdata.h"
+#include "processing/abstractprojectionfilter.h"
+
+class RoiProjectionData;
+
+// AbstractViewFilter
+// projection filter that processes each view independently of all other views:
+// -> filterView() can be applied to a single view as soon as it is available, e.g. to the views of
+//    a block while the projector is computing the next block (see StreamingFilterExtension)
+// -> filterView() must support concurrent calls for different views
+// -> the default implementation of filter() processes all views in parallel (ThreadPool)
+// -> filterRoi() filters compacted projections (see RoiProjectionData), the results outside of
+//    the ROIs are dropped; the default implementation expands one view at a time for filterView(),
+//    sub-classes override it to process the ROI data only (e.g. MaskingFilter)
+class AbstractViewFilter : public CTL::AbstractProjectionFilter
+{
+public:
+    virtual void filterView(CTL::SingleViewData& view) = 0;
+    virtual void filterRoi(RoiProjectionData& projections);
+
+    // AbstractProjectionFilter interface
+    void filter(CTL::ProjectionData& projections) override;
+};
+
+#endif // ABSTRACTVIEWFILTER_H
@@ -1,8 +1,104 @@
 #include "custommodels.h"
 #include "io/serializationhelper.h"
 
+// AVX2/AVX-512 code paths are compiled for their instruction set only (target attribute or
+// intrinsics on MSVC), the remaining code needs no specific instruction set; the path is selected
+// at run time depending on the CPU (see instructionSet())
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CUSTOMMODELS_SIMD
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define CUSTOMMODELS_SIMD
+#define TARGET_AVX2
+#define TARGET_AVX512
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
 DECLARE_SERIALIZABLE_TYPE(QuadraticFunctionModel)
 
+namespace {
+
+#if defined(CUSTOMMODELS_SIMD)
+
+enum class InstructionSet { Scalar, AVX2, AVX512 };
+
+// widest instruction set supported by the CPU and enabled by the OS (detected once)
+InstructionSet instructionSet()
+{
+    static const auto ret = [] () -> InstructionSet {
+#if defined(__GNUC__)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f"))
+            return InstructionSet::AVX512;
+        if(__builtin_cpu_supports("avx2"))
+            return InstructionSet::AVX2;
+#else
+        int info[4];
+        __cpuid(info, 0);
+        const auto maxLeaf = info[0];
+        __cpuid(info, 1);
+        const auto osxsaveAndAvx = (1 << 27) | (1 << 28);
+        if(maxLeaf >= 7 && (info[2] & osxsaveAndAvx) == osxsaveAndAvx)
+        {
+            const auto xcr0 = _xgetbv(0); // register state saved by the OS
+            __cpuidex(info, 7, 0);
+            if((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+                return InstructionSet::AVX512;
+            if((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+                return InstructionSet::AVX2;
+        }
+#endif
+        return InstructionSet::Scalar;
+    }();
+
+    return ret;
+}
+
+// the following kernels process full vectors only and return the number of processed elements;
+// same operation order as the scalar versions, i.e. identical results
+// (the *_round_ps products in the AVX-512 kernels prevent the compiler from contracting them with
+// the subsequent additions to FMA instructions, which are part of AVX-512F)
+
+TARGET_AVX512 size_t quadraticAVX512(float a, float b, float c, const float* positions, float* values,
+                                     size_t count)
+{
+    const auto va = _mm512_set1_ps(a);
+    const auto vb = _mm512_set1_ps(b);
+    const auto vc = _mm512_set1_ps(c);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        const auto x = _mm512_loadu_ps(positions + i);
+        const auto ax2 = _mm512_mul_round_ps(_mm512_mul_ps(va, x), x, _MM_FROUND_CUR_DIRECTION);
+        const auto bx = _mm512_mul_round_ps(vb, x, _MM_FROUND_CUR_DIRECTION);
+        _mm512_storeu_ps(values + i, _mm512_add_ps(_mm512_add_ps(ax2, bx), vc));
+    }
+    return i;
+}
+
+TARGET_AVX2 size_t quadraticAVX2(float a, float b, float c, const float* positions, float* values,
+                                 size_t count)
+{
+    const auto va = _mm256_set1_ps(a);
+    const auto vb = _mm256_set1_ps(b);
+    const auto vc = _mm256_set1_ps(c);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const auto x = _mm256_loadu_ps(positions + i);
+        const auto ax2 = _mm256_mul_ps(_mm256_mul_ps(va, x), x);
+        _mm256_storeu_ps(values + i, _mm256_add_ps(_mm256_add_ps(ax2, _mm256_mul_ps(vb, x)), vc));
+    }
+    return i;
+}
+
+#endif // CUSTOMMODELS_SIMD
+
+} // unnamed namespace
+
 QuadraticFunctionModel::QuadraticFunctionModel(float a, float b, float c)
     : m_a(a)
     , m_b(b)
@@ -15,6 +111,25 @@ float QuadraticFunctionModel::valueAt(float position) const
     return m_a * position * position + m_b * position + m_c;
 }
 
+// vectorized evaluation (AVX-512 or AVX2, depending on the CPU); identical results as valueAt()
+void QuadraticFunctionModel::valuesAt(const float* positions, float* values, size_t count) const
+{
+    size_t i = 0;
+
+#if defined(CUSTOMMODELS_SIMD)
+    switch(instructionSet())
+    {
+    case InstructionSet::AVX512: i = quadraticAVX512(m_a, m_b, m_c, positions, values, count); break;
+    case InstructionSet::AVX2:   i = quadraticAVX2(m_a, m_b, m_c, positions, values, count); break;
+    case InstructionSet::Scalar: break;
+    }
+#endif
+
+    // remainder (or all elements if the CPU supports neither AVX2 nor AVX-512)
+    for(; i < count; ++i)
+        values[i] = m_a * positions[i] * positions[i] + m_b * positions[i] + m_c;
+}
+
 CTL::AbstractDataModel* QuadraticFunctionModel::clone() const
 {
     return new QuadraticFunctionModel(*this);
@@ -1,10 +1,10 @@
 #ifndef CUSTOMMODELS_H
 #define CUSTOMMODELS_H
 
-#include "models/abstractdatamodel.h"
+#include "batchdatamodel.h"
 
 // f(x) = ax² + bx + c
-class QuadraticFunctionModel : public CTL::AbstractDataModel
+class QuadraticFunctionModel : public AbstractBatchDataModel
 {
     CTL_TYPE_ID(CTL::AbstractDataModel::UserType + 1);
 
@@ -15,6 +15,9 @@ public:
     float valueAt(float position) const override;
     CTL::AbstractDataModel* clone() const override;
 
+    // AbstractBatchDataModel interface
+    void valuesAt(const float* positions, float* values, size_t count) const override;
+
     // de-/serialization
     QVariant parameter() const override;
     void setParameter(const QVariant& parameter) override;
@@ -1,40 +1,259 @@
 #include "customprojectionfilters.h"
+#include "threadpool.h"
 
 #include "img/projectiondata.h"
-#include "processing/range.h"
 
 #include <QDebug>
 
+#include <algorithm>
+#include <cmath>
+
 DECLARE_SERIALIZABLE_TYPE(MaskingFilter)
 DECLARE_SERIALIZABLE_TYPE(LinearExtrapolationFilter)
 
 MaskingFilter::MaskingFilter(const QRect& mask)
-    : m_border(mask)
+    : m_type(Rect)
+    , m_border(mask)
+{
+}
+
+MaskingFilter::MaskingFilter(const QPolygonF& mask)
+    : m_type(Polygon)
+    , m_polygon(mask)
 {
 }
 
+MaskingFilter::MaskingFilter(const CTL::Chunk2D<float>& mask)
+    : m_type(Bitmap)
+    , m_bitmapSpans(mask.height())
+    , m_bitmapWidth(mask.width())
+{
+    // run-length encoding of the rows
+    for(uint row = 0; row < mask.height(); ++row)
+    {
+        const auto rowPtr = mask.rawData() + size_t(row) * mask.width();
+        for(uint ch = 0; ch < mask.width(); )
+        {
+            const auto begin = std::find_if(rowPtr + ch, rowPtr + mask.width(),
+                                            [] (float val) { return val != 0.0f; });
+            const auto end = std::find(begin, rowPtr + mask.width(), 0.0f);
+            if(begin != end)
+                m_bitmapSpans[row].push_back({ static_cast<uint>(begin - rowPtr), static_cast<uint>(end - rowPtr) });
+            ch = static_cast<uint>(end - rowPtr);
+        }
+    }
+}
+
 void MaskingFilter::filter(CTL::ProjectionData& projections)
 {
-    // loop over all view
-    for(auto& view : projections.data())
+    const auto nbChannels = projections.dimensions().nbChannels;
+    const auto nbRows = projections.dimensions().nbRows;
+    const auto nbModules = projections.dimensions().nbModules;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return;
+
+    const auto spans = insideSpans(nbChannels, nbRows);
+
+    // all modules of all views in parallel
+    ThreadPool::instance().run(projections.dimensions().nbViews * size_t(nbModules), [&] (size_t i) {
+        clearOutside(projections.data()[i / nbModules].data()[i % nbModules], spans);
+    });
+}
+
+void MaskingFilter::filterView(CTL::SingleViewData& view)
+{
+    const auto nbChannels = view.dimensions().nbChannels;
+    const auto nbRows = view.dimensions().nbRows;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return;
+
+    const auto spans = insideSpans(nbChannels, nbRows);
+    for(auto& module : view.data())
+        clearOutside(module, spans);
+}
+
+void MaskingFilter::filterRoi(RoiProjectionData& projections)
+{
+    const auto nbChannels = projections.dimensions().nbChannels;
+    const auto nbRows = projections.dimensions().nbRows;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return;
+
+    clearOutside(projections, insideSpans(nbChannels, nbRows));
+}
+
+// masked copy in compacted form: the ROI of all views is the bounding box of the mask
+// (the pixels outside of it are neither read nor written)
+RoiProjectionData MaskingFilter::compact(const CTL::ProjectionData& projections) const
+{
+    const auto nbChannels = projections.dimensions().nbChannels;
+    const auto nbRows = projections.dimensions().nbRows;
+    const auto nbViews = projections.dimensions().nbViews;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return RoiProjectionData(projections, std::vector<QRect>(nbViews, QRect(0, 0, nbChannels, nbRows)));
+
+    const auto spans = insideSpans(nbChannels, nbRows);
+
+    QRect boundingBox;
+    for(uint row = 0; row < nbRows; ++row)
+        if(!spans[row].empty())
+            boundingBox |= QRect(QPoint(spans[row].front().begin, row), QPoint(spans[row].back().end - 1, row));
+
+    // clear the parts of the ROI that are outside of the mask (e.g. corners of a polygon)
+    RoiProjectionData ret(projections, std::vector<QRect>(nbViews, boundingBox));
+    clearOutside(ret, spans);
+
+    return ret;
+}
+
+bool MaskingFilter::isApplicable(uint nbChannels, uint nbRows) const
+{
+    if(m_type == Bitmap && (m_bitmapWidth != nbChannels || m_bitmapSpans.size() != nbRows))
+    {
+        qCritical() << "Could not apply MaskingFilter. Size of the mask bitmap does not match the "
+                       "module dimensions.";
+        return false;
+    }
+
+    return true;
+}
+
+void MaskingFilter::clearOutside(CTL::Chunk2D<float>& module, const RowSpans& spans)
+{
+    const auto nbChannels = module.width();
+    for(uint row = 0; row < module.height(); ++row)
+    {
+        const auto rowPtr = module.rawData() + size_t(row) * nbChannels;
+        uint outsideBegin = 0;
+        for(const auto& span : spans[row])
+        {
+            std::fill(rowPtr + outsideBegin, rowPtr + span.begin, 0.0f);
+            outsideBegin = span.end;
+        }
+        std::fill(rowPtr + outsideBegin, rowPtr + nbChannels, 0.0f);
+    }
+}
+
+// clears the pixels of the ROIs that are outside of the mask (spans clipped to the ROI of each view)
+void MaskingFilter::clearOutside(RoiProjectionData& projections, const RowSpans& spans)
+{
+    const auto nbModules = projections.dimensions().nbModules;
+
+    ThreadPool::instance().run(projections.nbViews(), [&] (size_t view) {
+        const auto& region = projections.region(static_cast<uint>(view));
+        if(region.isEmpty())
+            return;
+
+        const auto left = static_cast<uint>(region.left());
+        const auto end = static_cast<uint>(region.right() + 1);
+        auto rowPtr = projections.rawData(static_cast<uint>(view));
+        for(uint module = 0; module < nbModules; ++module)
+            for(int row = region.top(); row <= region.bottom(); ++row, rowPtr += end - left)
+            {
+                auto outsideBegin = left;
+                for(const auto& span : spans[row])
+                {
+                    const auto insideBegin = qBound(outsideBegin, span.begin, end);
+                    std::fill(rowPtr + (outsideBegin - left), rowPtr + (insideBegin - left), 0.0f);
+                    outsideBegin = qBound(outsideBegin, span.end, end);
+                }
+                std::fill(rowPtr + (outsideBegin - left), rowPtr + (end - left), 0.0f);
+            }
+    });
+}
+
+// sorted, non-overlapping inside spans of each row (clipped to the module)
+MaskingFilter::RowSpans MaskingFilter::insideSpans(uint nbChannels, uint nbRows) const
+{
+    RowSpans ret(nbRows);
+
+    switch(m_type)
+    {
+    case Rect:
+    {
+        const auto begin = static_cast<uint>(qBound(0, m_border.left(), int(nbChannels)));
+        const auto end = static_cast<uint>(qBound(0, m_border.right() + 1, int(nbChannels)));
+        if(begin >= end)
+            break;
+        for(int row = std::max(m_border.top(), 0); row <= std::min(m_border.bottom(), int(nbRows) - 1); ++row)
+            ret[row].push_back({ begin, end });
+        break;
+    }
+    case Polygon:
     {
-        // loop over all modules
-        for(auto& module : view.data())
+        // scanline through the pixel centers: intersections with all edges (half-open in y)
+        std::vector<double> crossings;
+        for(uint row = 0; row < nbRows; ++row)
         {
-            for(uint ch = 0; ch < projections.dimensions().nbChannels; ++ch)
-                for(uint row = 0; row < projections.dimensions().nbRows; ++row)
-                    if(!m_border.contains(ch, row))
-                        module(ch, row) = 0.0f;
+            crossings.clear();
+            for(int e = 0; e < m_polygon.size(); ++e)
+            {
+                const auto& p1 = m_polygon.at(e);
+                const auto& p2 = m_polygon.at((e + 1) % m_polygon.size());
+                if((p1.y() <= row) != (p2.y() <= row))
+                    crossings.push_back(p1.x() + (row - p1.y()) * (p2.x() - p1.x()) / (p2.y() - p1.y()));
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            // odd-even rule: pixels in between crossings 2k and 2k+1 are inside
+            for(size_t c = 0; c + 1 < crossings.size(); c += 2)
+            {
+                const auto begin = static_cast<uint>(qBound(0.0, std::ceil(crossings[c]), double(nbChannels)));
+                const auto end = static_cast<uint>(qBound(0.0, std::ceil(crossings[c + 1]), double(nbChannels)));
+                if(begin < end)
+                    ret[row].push_back({ begin, end });
+            }
         }
+        break;
+    }
+    case Bitmap:
+        ret = m_bitmapSpans;
+        break;
     }
+
+    return ret;
 }
 
 QVariant MaskingFilter::parameter() const
 {
     auto parMap = CTL::AbstractProjectionFilter::parameter().toMap();
 
-    QVariantList list{ m_border.x(), m_border.y(), m_border.width(), m_border.height() };
-    parMap.insert("mask border", list);
+    switch(m_type)
+    {
+    case Rect:
+    {
+        QVariantList list{ m_border.x(), m_border.y(), m_border.width(), m_border.height() };
+        parMap.insert("mask border", list);
+        break;
+    }
+    case Polygon:
+    {
+        QVariantList list;
+        for(const auto& point : m_polygon)
+            list << point.x() << point.y();
+        parMap.insert("mask polygon", list);
+        break;
+    }
+    case Bitmap:
+    {
+        // run-length encoded: row, begin, end of each span
+        QVariantList list;
+        for(uint row = 0; row < m_bitmapSpans.size(); ++row)
+            for(const auto& span : m_bitmapSpans[row])
+                list << row << span.begin << span.end;
+
+        QVariantMap bitmap;
+        bitmap.insert("width", m_bitmapWidth);
+        bitmap.insert("height", static_cast<uint>(m_bitmapSpans.size()));
+        bitmap.insert("spans", list);
+        parMap.insert("mask bitmap", bitmap);
+        break;
+    }
+    }
 
     return parMap;
 }
@@ -49,72 +268,237 @@ void MaskingFilter::setParameter(const QVariant &parameter)
         auto rectValues = parMap.value("mask border").toList();
         m_border = QRect(rectValues.at(0).toInt(), rectValues.at(1).toInt(),
                          rectValues.at(2).toInt(), rectValues.at(3).toInt());
+        m_type = Rect;
+    }
+    if(parMap.contains("mask polygon"))
+    {
+        const auto coords = parMap.value("mask polygon").toList();
+        m_polygon.clear();
+        for(int i = 0; i + 1 < coords.size(); i += 2)
+            m_polygon << QPointF(coords.at(i).toDouble(), coords.at(i + 1).toDouble());
+        m_type = Polygon;
+    }
+    if(parMap.contains("mask bitmap"))
+    {
+        const auto bitmap = parMap.value("mask bitmap").toMap();
+        const auto spans = bitmap.value("spans").toList();
+        m_bitmapWidth = bitmap.value("width").toUInt();
+        m_bitmapSpans.assign(bitmap.value("height").toUInt(), {});
+        for(int i = 0; i + 2 < spans.size(); i += 3)
+        {
+            const auto row = spans.at(i).toUInt();
+            if(row < m_bitmapSpans.size())
+                m_bitmapSpans[row].push_back({ spans.at(i + 1).toUInt(), spans.at(i + 2).toUInt() });
+        }
+        m_type = Bitmap;
     }
 }
 
-LinearExtrapolationFilter::LinearExtrapolationFilter(const QRect &mask)
+LinearExtrapolationFilter::LinearExtrapolationFilter(const QRect &mask, Mode mode)
     : m_border(mask)
+    , m_mode(mode)
 {
 }
 
 void LinearExtrapolationFilter::filter(CTL::ProjectionData& projections)
 {
-    QRect projExtent(0, 0, projections.viewDimensions().nbChannels, projections.viewDimensions().nbRows);
+    const auto nbChannels = projections.viewDimensions().nbChannels;
+    const auto nbRows     = projections.viewDimensions().nbRows;
+    const auto nbModules  = projections.viewDimensions().nbModules;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return;
+
+    const auto weights = ramps(nbChannels, nbRows);
+
+    ThreadPool::instance().run(projections.dimensions().nbViews * size_t(nbModules), [&] (size_t i) {
+        extrapolate(projections.data()[i / nbModules].data()[i % nbModules], weights);
+    });
+}
+
+void LinearExtrapolationFilter::filterView(CTL::SingleViewData& view)
+{
+    const auto nbChannels = view.dimensions().nbChannels;
+    const auto nbRows     = view.dimensions().nbRows;
+
+    if(!isApplicable(nbChannels, nbRows))
+        return;
+
+    const auto weights = ramps(nbChannels, nbRows);
+    for(auto& module : view.data())
+        extrapolate(module, weights);
+}
+
+// single pass over the output: the pixels inside of the mask border are copied from the ROI (zero
+// outside of it), all others are written by the extrapolation (no zero-initialization required)
+CTL::ProjectionData LinearExtrapolationFilter::expand(const RoiProjectionData& projections) const
+{
+    const auto& dims = projections.dimensions();
+
+    if(!isApplicable(dims.nbChannels, dims.nbRows))
+        return projections.toProjectionData();
+
+    CTL::ProjectionData ret(dims.nbChannels, dims.nbRows, dims.nbModules);
+    ret.allocateMemory(dims.nbViews);
+
+    const auto weights = ramps(dims.nbChannels, dims.nbRows);
+    const auto left = m_border.left();
+    const auto right = m_border.right();
+
+    ThreadPool::instance().run(dims.nbViews * size_t(dims.nbModules), [&] (size_t i) {
+        const auto view = static_cast<uint>(i / dims.nbModules);
+        const auto moduleNb = static_cast<uint>(i % dims.nbModules);
+        const auto& region = projections.region(view);
+        const auto moduleSrc = projections.rawData(view)
+                + size_t(std::max(region.width(), 0)) * std::max(region.height(), 0) * moduleNb;
+
+        auto& module = ret.data()[view].data()[moduleNb];
+        for(int row = m_border.top(); row <= m_border.bottom(); ++row)
+        {
+            const auto dst = module.rawData() + size_t(row) * dims.nbChannels;
+            const auto begin = qBound(left, region.left(), right + 1);
+            const auto end = qBound(begin, region.right() + 1, right + 1);
+            if(row < region.top() || row > region.bottom() || begin == end)
+            {
+                std::fill(dst + left, dst + right + 1, 0.0f);
+                continue;
+            }
+
+            std::fill(dst + left, dst + begin, 0.0f);
+            std::copy_n(moduleSrc + size_t(row - region.top()) * region.width() + (begin - region.left()),
+                        end - begin, dst + begin);
+            std::fill(dst + end, dst + right + 1, 0.0f);
+        }
+
+        extrapolate(module, weights);
+    });
+
+    return ret;
+}
+
+bool LinearExtrapolationFilter::isApplicable(uint nbChannels, uint nbRows) const
+{
+    QRect projExtent(0, 0, nbChannels, nbRows);
     if(!projExtent.contains(m_border))
     {
         qCritical() << "Could not apply LinearExtrapolationFilter. Filter borders are (partially) "
                        "outside projection data extent.";
-        return;
+        return false;
     }
 
-    const auto pixLeft   = static_cast<uint>(m_border.left());
-    const auto pixRight  = projections.viewDimensions().nbChannels - static_cast<uint>(m_border.right());
-    const auto pixTop    = static_cast<uint>(m_border.top());
-    const auto pixBottom = projections.viewDimensions().nbRows - static_cast<uint>(m_border.bottom());
+    return true;
+}
 
-    // loop over all views
-    for(auto& view : projections.data())
-    {
-        // loop over all modules
-        for(auto& module : view.data())
+// weight of sample i: from + (to - from) * weight[i], same positions as Range<float>::linspace
+LinearExtrapolationFilter::Ramps LinearExtrapolationFilter::ramps(uint nbChannels, uint nbRows) const
+{
+    const auto pi = std::acos(-1.0f);
+    const auto rampWeights = [this, pi] (uint nbSamples) {
+        std::vector<float> ret(nbSamples, 0.0f);
+        for(uint i = 1; i < nbSamples; ++i)
         {
-            // interpolate the channels
-            for(uint row = 0; row < module.dimensions().height; ++row)
-            {
-                // left side
-                auto interpolatedData = CTL::Range<float>::linspace(0.0f, module(m_border.left(), row), pixLeft);
-                for(uint ch = 0; ch < pixLeft; ++ch)
-                    module(ch, row) = interpolatedData[ch];
-
-                // right side
-                interpolatedData = CTL::Range<float>::linspace(module(m_border.right(), row), 0.0f, pixRight);
-                for(uint ch = 0; ch < pixRight; ++ch)
-                    module(m_border.right() + ch, row) = interpolatedData[ch];
-            }
+            const auto t = float(i) / float(nbSamples - 1);
+            ret[i] = (m_mode == Cosine) ? 0.5f - 0.5f * std::cos(pi * t) : t;
+        }
+        return ret;
+    };
 
-            // interpolate the rows
-            for(uint ch = 0; ch < module.dimensions().width; ++ch)
-            {
-                // top side
-                auto interpolatedData = CTL::Range<float>::linspace(0.0f, module(ch, m_border.top()), pixTop);
-                for(uint row = 0; row < pixTop; ++row)
-                    module(ch, row) = interpolatedData[row];
-
-                // bottom side
-                interpolatedData = CTL::Range<float>::linspace(module(ch, m_border.bottom()), 0.0f, pixBottom);
-                for(uint row = 0; row < pixBottom; ++row)
-                    module(ch, m_border.bottom() + row) = interpolatedData[row];
-            }
+    Ramps ret;
+    ret.left   = rampWeights(static_cast<uint>(m_border.left()));
+    ret.right  = rampWeights(nbChannels - static_cast<uint>(m_border.right()));
+    ret.top    = rampWeights(static_cast<uint>(m_border.top()));
+    ret.bottom = rampWeights(nbRows - static_cast<uint>(m_border.bottom()));
+
+    return ret;
+}
+
+void LinearExtrapolationFilter::extrapolate(CTL::Chunk2D<float>& module, const Ramps& ramps) const
+{
+    const auto nbChannels = module.width();
+    const auto nbRows     = module.height();
+
+    const auto left   = static_cast<uint>(m_border.left());
+    const auto right  = static_cast<uint>(m_border.right());
+    const auto top    = static_cast<uint>(m_border.top());
+    const auto bottom = static_cast<uint>(m_border.bottom());
+
+    // symmetric continuation: offset 'k' from the border into the inside (of size 'n')
+    const auto mirrored = [] (uint k, uint n) {
+        k %= 2 * n;
+        return k < n ? k : 2 * n - 1 - k;
+    };
+    const auto insideWidth  = right - left + 1;
+    const auto insideHeight = bottom - top + 1;
+
+    const auto rowPtr = [&module, nbChannels] (uint row) { return module.rawData() + size_t(row) * nbChannels; };
+
+    // extrapolate the channels (left and right of the mask)
+    for(uint row = 0; row < nbRows; ++row)
+    {
+        const auto data = rowPtr(row);
+        if(m_mode == Mirror)
+        {
+            for(uint k = 0; k < left; ++k)
+                data[left - 1 - k] = data[left + mirrored(k, insideWidth)];
+            for(uint k = 0; right + 1 + k < nbChannels; ++k)
+                data[right + 1 + k] = data[right - mirrored(k, insideWidth)];
+            continue;
         }
+
+        const auto leftValue = data[left];
+        for(uint ch = 0; ch < left; ++ch)
+            data[ch] = leftValue * ramps.left[ch];
+
+        const auto rightValue = data[right];
+        for(uint k = 0; k < ramps.right.size(); ++k)
+            data[right + k] = rightValue - rightValue * ramps.right[k];
+    }
+
+    // extrapolate the rows (above and below the mask), entire rows at once
+    const auto topRow = rowPtr(top);
+    const auto bottomRow = rowPtr(bottom);
+    if(m_mode == Mirror)
+    {
+        for(uint k = 0; k < top; ++k)
+            std::copy_n(rowPtr(top + mirrored(k, insideHeight)), nbChannels, rowPtr(top - 1 - k));
+        for(uint k = 0; bottom + 1 + k < nbRows; ++k)
+            std::copy_n(rowPtr(bottom - mirrored(k, insideHeight)), nbChannels, rowPtr(bottom + 1 + k));
+        return;
+    }
+
+    for(uint row = 0; row < top; ++row)
+    {
+        const auto data = rowPtr(row);
+        const auto weight = ramps.top[row];
+        for(uint ch = 0; ch < nbChannels; ++ch)
+            data[ch] = topRow[ch] * weight;
+    }
+    for(uint k = 1; k < ramps.bottom.size(); ++k)
+    {
+        const auto data = rowPtr(bottom + k);
+        const auto weight = ramps.bottom[k];
+        for(uint ch = 0; ch < nbChannels; ++ch)
+            data[ch] = bottomRow[ch] - bottomRow[ch] * weight;
     }
 }
 
+LinearExtrapolationFilter::Mode LinearExtrapolationFilter::mode() const
+{
+    return m_mode;
+}
+
+void LinearExtrapolationFilter::setMode(Mode mode)
+{
+    m_mode = mode;
+}
+
 QVariant LinearExtrapolationFilter::parameter() const
 {
     auto parMap = CTL::AbstractProjectionFilter::parameter().toMap();
 
     QVariantList list{ m_border.x(), m_border.y(), m_border.width(), m_border.height() };
     parMap.insert("mask border", list);
+    parMap.insert("mode", static_cast<int>(m_mode));
 
     return parMap;
 }
@@ -130,4 +514,6 @@ void LinearExtrapolationFilter::setParameter(const QVariant &parameter)
         m_border = QRect(rectValues.at(0).toInt(), rectValues.at(1).toInt(),
                          rectValues.at(2).toInt(), rectValues.at(3).toInt());
     }
+    if(parMap.contains("mode"))
+        m_mode = static_cast<Mode>(parMap.value("mode").toInt());
 }
@@ -1,51 +1,108 @@
 #ifndef CUSTOMPROJECTIONFILTERS_H
 #define CUSTOMPROJECTIONFILTERS_H
 
-#include "processing/abstractprojectionfilter.h"
+#include "abstractviewfilter.h"
+#include "roiprojectiondata.h"
 
+#include "img/chunk2d.h"
+
+#include <QPolygonF>
 #include <QRect>
 
 // MaskingFilter
-class MaskingFilter : public CTL::AbstractProjectionFilter
+// sets all pixels outside of the mask to zero; the mask can be a rectangle, a polygon (a pixel is
+// inside if its center is inside the polygon, odd-even rule) or a bitmap (pixels != 0 are inside)
+// -> the inside spans of each row are computed once per call of filter(), the outside parts are
+//    cleared with bulk writes; views and modules are processed in parallel (ThreadPool)
+// -> filterView() masks a single view (e.g. block-wise during the projection, see StreamingFilterExtension)
+// -> compact() creates a masked copy that only stores the bounding box of the mask (RoiProjectionData),
+//    filterRoi() masks compacted projections in place (only the ROIs are touched)
+class MaskingFilter : public AbstractViewFilter
 {
     CTL_TYPE_ID(CTL::AbstractProjectionFilter::UserType + 2)
 
 public:
     explicit MaskingFilter(const QRect& mask);
+    explicit MaskingFilter(const QPolygonF& mask);
+    explicit MaskingFilter(const CTL::Chunk2D<float>& mask);
 
     // AbstractProjectionFilter interface
     void filter(CTL::ProjectionData& projections) override;
 
+    // AbstractViewFilter interface
+    void filterView(CTL::SingleViewData& view) override;
+    void filterRoi(RoiProjectionData& projections) override;
+
+    RoiProjectionData compact(const CTL::ProjectionData& projections) const;
+
     // de-/serialization
     QVariant parameter() const override;
     void setParameter(const QVariant &parameter) override;
 
 private:
+    enum MaskType { Rect, Polygon, Bitmap };
+    struct Span { uint begin; uint end; }; // [begin, end)
+    using RowSpans = std::vector<std::vector<Span>>;
+
     MaskingFilter() = default;
 
+    bool isApplicable(uint nbChannels, uint nbRows) const;
+    RowSpans insideSpans(uint nbChannels, uint nbRows) const;
+    static void clearOutside(CTL::Chunk2D<float>& module, const RowSpans& spans);
+    static void clearOutside(RoiProjectionData& projections, const RowSpans& spans);
+
+    MaskType m_type = Rect;
     QRect m_border;
+    QPolygonF m_polygon;
+    RowSpans m_bitmapSpans;
+    uint m_bitmapWidth = 0;
 
 };
 
 // LinearExtrapolationFilter
-class LinearExtrapolationFilter : public CTL::AbstractProjectionFilter
+// extrapolates the projections outside of the mask (first along the rows, then along the channels):
+// -> Linear: linear ramp from the value at the mask border down to zero at the module border
+// -> Cosine: same, but with a smooth (cosine-shaped) roll-off
+// -> Mirror: symmetric continuation of the data inside the mask
+// views and modules are processed in parallel (ThreadPool), no allocations per row/column
+// -> expand() creates the extrapolated full-size projections directly from compacted ones
+//    (RoiProjectionData), i.e. without expanding them first
+class LinearExtrapolationFilter : public AbstractViewFilter
 {
     CTL_TYPE_ID(CTL::AbstractProjectionFilter::UserType + 3)
 
 public:
-    explicit LinearExtrapolationFilter(const QRect& mask);
+    enum Mode { Linear, Cosine, Mirror };
+
+    explicit LinearExtrapolationFilter(const QRect& mask, Mode mode = Linear);
 
     // AbstractProjectionFilter interface
     void filter(CTL::ProjectionData& projections) override;
 
+    // AbstractViewFilter interface
+    void filterView(CTL::SingleViewData& view) override;
+
+    CTL::ProjectionData expand(const RoiProjectionData& projections) const;
+
     // de-/serialization
     QVariant parameter() const override;
     void setParameter(const QVariant &parameter) override;
 
+    Mode mode() const;
+    void setMode(Mode mode);
+
 private:
+    // weights of the ramps (the same for all rows/columns of all modules)
+    struct Ramps { std::vector<float> left, right, top, bottom; };
+
     LinearExtrapolationFilter() = default;
 
+    bool isApplicable(uint nbChannels, uint nbRows) const;
+    Ramps ramps(uint nbChannels, uint nbRows) const;
+    void extrapolate(CTL::Chunk2D<float>& module, const Ramps& ramps) const;
+
     QRect m_border;
+    Mode m_mode = Linear;
 
 };
 
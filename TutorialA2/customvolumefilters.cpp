@@ -1,25 +1,320 @@
 #include "customvolumefilters.h"
+#include "batchdatamodel.h"
 
 #include "img/voxelvolume.h"
-#include "processing/neighborselector.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 DECLARE_SERIALIZABLE_TYPE(MovingAverageFilter)
+DECLARE_SERIALIZABLE_TYPE(GaussianFilter)
 DECLARE_SERIALIZABLE_TYPE(ModelApplicationFilter)
 
-void MovingAverageFilter::filter(CTL::VoxelVolume<float>& volume)
+namespace {
+
+// maps 'index' into [0, n-1] by mirroring at the borders (-1 -> 1, n -> n-2), which is the
+// same boundary handling as in CTL::NeighborSelector::voxelAndNeighborsMirrored()
+uint mirroredIndex(int index, int n)
+{
+    if(n == 1)
+        return 0;
+
+    const auto period = 2 * (n - 1);
+    index %= period;
+    if(index < 0)
+        index += period;
+
+    return static_cast<uint>(index < n ? index : period - index);
+}
+
+// box filter along x (contiguous rows)
+void boxFilterX(CTL::VoxelVolume<float>& volume, uint radius)
 {
+    const auto& dim = volume.dimensions();
+    const auto r = static_cast<int>(radius);
+    const auto norm = 1.0 / (2 * radius + 1);
+
+    // row padded with mirrored values on both sides
+    std::vector<float> paddedRow(dim.x + 2 * radius);
+
+    for(uint row = 0; row < dim.y * dim.z; ++row)
+    {
+        auto rowPtr = volume.rawData() + size_t(row) * dim.x;
+
+        for(int i = 0; i < static_cast<int>(paddedRow.size()); ++i)
+            paddedRow[i] = rowPtr[mirroredIndex(i - r, dim.x)];
+
+        double sum = 0.0;
+        for(uint i = 0; i < 2 * radius + 1; ++i)
+            sum += paddedRow[i];
+        rowPtr[0] = static_cast<float>(sum * norm);
+
+        for(uint x = 1; x < dim.x; ++x)
+        {
+            sum += paddedRow[x + 2 * radius] - paddedRow[x - 1];
+            rowPtr[x] = static_cast<float>(sum * norm);
+        }
+    }
+}
+
+// box filter over 'nbBlocks' consecutive blocks of 'blockSize' elements each
+// -> 'src(i)' points to the (unfiltered) block i, results are written to 'dst'
+// -> 'beforeWrite(i)' is called right before block i of 'dst' gets overwritten
+// the innermost loops run over contiguous memory and can be vectorized by the compiler
+template <class SourceBlock, class BeforeWrite>
+void boxFilterBlocks(float* dst, const SourceBlock& src, const BeforeWrite& beforeWrite,
+                     uint nbBlocks, size_t blockSize, uint radius)
+{
+    const auto r = static_cast<int>(radius);
+    const auto n = static_cast<int>(nbBlocks);
+    const auto norm = 1.0 / (2 * radius + 1);
+
+    std::vector<double> acc(blockSize, 0.0);
+    for(int k = -r; k <= r; ++k)
+    {
+        const float* block = src(mirroredIndex(k, n));
+        for(size_t i = 0; i < blockSize; ++i)
+            acc[i] += block[i];
+    }
+
+    for(int b = 0; b < n; ++b)
+    {
+        if(b > 0)
+        {
+            const float* added   = src(mirroredIndex(b + r, n));
+            const float* removed = src(mirroredIndex(b - r - 1, n));
+            for(size_t i = 0; i < blockSize; ++i)
+                acc[i] += double(added[i]) - double(removed[i]);
+        }
+
+        beforeWrite(static_cast<uint>(b));
+        auto out = dst + size_t(b) * blockSize;
+        for(size_t i = 0; i < blockSize; ++i)
+            out[i] = static_cast<float>(acc[i] * norm);
+    }
+}
+
+// box filter along y (blocks are rows within each z-slice)
+void boxFilterY(CTL::VoxelVolume<float>& volume, uint radius)
+{
+    const auto& dim = volume.dimensions();
+    const auto sliceSize = size_t(dim.x) * dim.y;
+
+    std::vector<float> slice(sliceSize);
+    for(uint z = 0; z < dim.z; ++z)
+    {
+        auto slicePtr = volume.rawData() + z * sliceSize;
+        std::copy(slicePtr, slicePtr + sliceSize, slice.begin());
+
+        const auto row = [&slice, &dim] (uint y) { return slice.data() + size_t(y) * dim.x; };
+        boxFilterBlocks(slicePtr, row, [] (uint) {}, dim.y, dim.x, radius);
+    }
+}
+
+// box filter along z (blocks are entire z-slices)
+// -> reads the unfiltered slices from a copy of the entire volume
+void boxFilterZ(CTL::VoxelVolume<float>& volume, uint radius)
+{
+    const auto& dim = volume.dimensions();
+    const auto sliceSize = size_t(dim.x) * dim.y;
+
     const auto volCopy = volume;
-    CTL::NeighborSelector selector(volCopy);
+    const auto slice = [&volCopy, sliceSize] (uint z) { return volCopy.rawData() + z * sliceSize; };
+    boxFilterBlocks(volume.rawData(), slice, [] (uint) {}, dim.z, sliceSize, radius);
+}
+
+// box filter along z (blocks are entire z-slices), in-place version
+// -> each slice is saved to a ring of (radius + 1) slices right before it gets overwritten;
+//    all unfiltered slices that are still required later on are either in the ring or not yet
+//    overwritten, so the result is identical to the copy-based version
+void boxFilterZInPlace(CTL::VoxelVolume<float>& volume, uint radius)
+{
+    const auto& dim = volume.dimensions();
+    const auto sliceSize = size_t(dim.x) * dim.y;
+    const auto ringSize = std::min(radius + 1, dim.z);
+    const auto data = volume.rawData();
+
+    std::vector<float> ring(ringSize * sliceSize);
+    uint nbSaved = 0; // slices [0, nbSaved) have been saved and overwritten
+
+    const auto slice = [&] (uint z) -> const float* {
+        return z < nbSaved ? ring.data() + (z % ringSize) * sliceSize
+                           : data + z * sliceSize;
+    };
+    const auto saveSlice = [&] (uint z) {
+        std::copy(data + z * sliceSize, data + (z + 1) * sliceSize, ring.data() + (z % ringSize) * sliceSize);
+        nbSaved = z + 1;
+    };
+    boxFilterBlocks(data, slice, saveSlice, dim.z, sliceSize, radius);
+}
+
+} // unnamed namespace
+
+MovingAverageFilter::MovingAverageFilter(uint radius, MemoryMode memoryMode)
+    : m_radius(radius)
+    , m_memoryMode(memoryMode)
+{
+}
+
+void MovingAverageFilter::filter(CTL::VoxelVolume<float>& volume)
+{
+    if(m_radius == 0)
+        return;
+
+    // the 3D box is separable -> three 1D passes, each walking through memory in layout order
+    boxFilterX(volume, m_radius);
+    boxFilterY(volume, m_radius);
+    if(m_memoryMode == InPlace)
+        boxFilterZInPlace(volume, m_radius);
+    else
+        boxFilterZ(volume, m_radius);
+}
+
+uint MovingAverageFilter::radius() const
+{
+    return m_radius;
+}
+
+void MovingAverageFilter::setRadius(uint radius)
+{
+    m_radius = radius;
+}
+
+MovingAverageFilter::MemoryMode MovingAverageFilter::memoryMode() const
+{
+    return m_memoryMode;
+}
 
-    for(uint x = 0; x < volume.dimensions().x; ++x)
-        for(uint y = 0; y < volume.dimensions().y; ++y)
-            for(uint z = 0; z < volume.dimensions().z; ++z)
-            {
-                const auto values = selector.voxelAndNeighborsMirrored(x, y, z);
-                const auto sum = std::accumulate(values.cbegin(), values.cend(), 0.0f);
+void MovingAverageFilter::setMemoryMode(MemoryMode memoryMode)
+{
+    m_memoryMode = memoryMode;
+}
+
+QVariant MovingAverageFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("radius", m_radius);
+    parMap.insert("memory mode", static_cast<int>(m_memoryMode));
+
+    return parMap;
+}
+
+void MovingAverageFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("radius"))
+        m_radius = parMap.value("radius").toUInt();
+    if(parMap.contains("memory mode"))
+        m_memoryMode = static_cast<MemoryMode>(parMap.value("memory mode").toInt());
+}
+
+GaussianFilter::GaussianFilter(float sigma, uint nbPasses)
+    : m_sigma(sigma)
+    , m_nbPasses(nbPasses)
+{
+}
+
+void GaussianFilter::filter(CTL::VoxelVolume<float>& volume)
+{
+    if(m_sigma < 0.0f)
+    {
+        qCritical() << "Could not apply GaussianFilter. Negative standard deviation:" << m_sigma;
+        return;
+    }
+
+    const auto radii = boxRadii();
+
+    // all passes along one axis before the next axis (box filters commute)
+    for(auto r : radii)
+        if(r > 0)
+            boxFilterX(volume, r);
+    for(auto r : radii)
+        if(r > 0)
+            boxFilterY(volume, r);
+    for(auto r : radii)
+        if(r > 0)
+            boxFilterZInPlace(volume, r);
+}
+
+float GaussianFilter::sigma() const
+{
+    return m_sigma;
+}
+
+void GaussianFilter::setSigma(float sigma)
+{
+    m_sigma = sigma;
+}
+
+uint GaussianFilter::nbPasses() const
+{
+    return m_nbPasses;
+}
+
+void GaussianFilter::setNbPasses(uint nbPasses)
+{
+    m_nbPasses = nbPasses;
+}
+
+uint GaussianFilter::reach() const
+{
+    const auto radii = boxRadii();
+    return std::accumulate(radii.cbegin(), radii.cend(), 0u);
+}
+
+// radii of the box filters, such that the variance of their convolution matches sigma² as
+// closely as possible (a box of width w = 2r+1 has a variance of (w² - 1) / 12); the first
+// passes use the next smaller odd width below the ideal width, the remaining ones the next larger
+std::vector<uint> GaussianFilter::boxRadii() const
+{
+    if(m_nbPasses == 0 || !(m_sigma > 0.0f))
+        return std::vector<uint>(m_nbPasses, 0u);
+
+    const auto n = double(m_nbPasses);
+    const auto variance = double(m_sigma) * m_sigma;
+    const auto idealWidth = std::sqrt(12.0 * variance / n + 1.0);
+
+    auto lowerWidth = static_cast<int>(std::floor(idealWidth));
+    if(lowerWidth % 2 == 0)
+        --lowerWidth;
+
+    const auto nbLower = std::round((12.0 * variance - n * lowerWidth * lowerWidth - 4.0 * n * lowerWidth - 3.0 * n)
+                                    / (-4.0 * lowerWidth - 4.0));
+    const auto nbLowerPasses = static_cast<uint>(std::min(std::max(nbLower, 0.0), n));
+
+    std::vector<uint> ret(m_nbPasses, static_cast<uint>(lowerWidth + 1) / 2);
+    std::fill(ret.begin(), ret.begin() + nbLowerPasses, static_cast<uint>(lowerWidth - 1) / 2);
+
+    return ret;
+}
+
+QVariant GaussianFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("sigma", m_sigma);
+    parMap.insert("passes", m_nbPasses);
+
+    return parMap;
+}
+
+void GaussianFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
 
-                volume(x, y, z) = sum / float(values.size());
-            }
+    if(parMap.contains("sigma"))
+        m_sigma = parMap.value("sigma").toFloat();
+    if(parMap.contains("passes"))
+        m_nbPasses = parMap.value("passes").toUInt();
 }
 
 ModelApplicationFilter::ModelApplicationFilter(std::shared_ptr<CTL::AbstractDataModel> model)
@@ -29,8 +324,9 @@ ModelApplicationFilter::ModelApplicationFilter(std::shared_ptr<CTL::AbstractData
 
 void ModelApplicationFilter::filter(CTL::VoxelVolume<float>& volume)
 {
-    for(auto& voxel : volume)
-        voxel = m_model->valueAt(voxel);
+    // in-place batch evaluation (vectorized for models that support it)
+    auto& voxels = volume.data();
+    evaluateBatch(*m_model, voxels.data(), voxels.data(), voxels.size());
 }
 
 QVariant ModelApplicationFilter::parameter() const
@@ -5,16 +5,65 @@
 #include "processing/abstractvolumefilter.h"
 
 // MovingAverageFilter
+// box filter over the (2r+1)³ neighborhood of each voxel (mirrored at the volume borders);
+// computed separably with running sums, i.e. the cost per voxel does not depend on the radius
+// memory modes: 'CopyVolume' temporarily requires a full copy of the volume, 'InPlace' only a
+// few slices (radius + 3) -> both modes yield identical results
 class MovingAverageFilter : public CTL::AbstractVolumeFilter
 {
     CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 4)
 
 public:
+    enum MemoryMode { CopyVolume, InPlace };
+
+    explicit MovingAverageFilter(uint radius = 1, MemoryMode memoryMode = CopyVolume);
+
     // AbstractVolumeFilter interface
     void filter(CTL::VoxelVolume<float> &volume) override;
 
+    uint radius() const;
+    void setRadius(uint radius);
+    MemoryMode memoryMode() const;
+    void setMemoryMode(MemoryMode memoryMode);
+
     // de-/serialization
-    // -> no custom implementations needed, since class has no additional members
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    uint m_radius = 1;
+    MemoryMode m_memoryMode = CopyVolume;
+};
+
+// GaussianFilter
+// approximation of a Gaussian filter (standard deviation 'sigma' in voxels) by 'nbPasses'
+// successive box filters of (almost) equal size, mirrored at the volume borders;
+// the cost per voxel does not depend on sigma
+class GaussianFilter : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 8)
+
+public:
+    explicit GaussianFilter(float sigma = 1.0f, uint nbPasses = 3);
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+
+    float sigma() const;
+    void setSigma(float sigma);
+    uint nbPasses() const;
+    void setNbPasses(uint nbPasses);
+    uint reach() const; // number of neighbors (in each direction) that affect a voxel
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    std::vector<uint> boxRadii() const;
+
+    float m_sigma = 1.0f;
+    uint m_nbPasses = 3;
 };
 
 // ModelApplicationFilter
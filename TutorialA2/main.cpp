@@ -6,8 +6,12 @@
 #include "ctl_qtgui.h"
 
 #include "custommodels.h"
+#include "rawdataio.h"
 #include "customvolumefilters.h"
 #include "customprojectionfilters.h"
+#include "slabparallelfilter.h"
+#include "streamingfilterextension.h"
+#include "volumefilterpipeline.h"
 
 using namespace CTL;
 
@@ -17,6 +21,7 @@ void testSerialization(AbstractProjectionFilter& filter, const ProjectionData& i
 
 // implementations
 void useProjectionFilter();
+void useStreamingFilter();
 void useVolumeFilter(std::shared_ptr<CTL::AbstractVolumeFilter> volumeFilt);
 
 
@@ -32,14 +37,34 @@ int main(int argc, char *argv[])
         // projection filters
         useProjectionFilter();
 
+        // projection filters applied while the projector is still running
+        useStreamingFilter();
+
         // volume filters
         auto filter = std::make_shared<MovingAverageFilter>();
         useVolumeFilter(filter);
 
+        // larger neighborhood (7x7x7) at the same cost per voxel
+        useVolumeFilter(std::make_shared<MovingAverageFilter>(3));
+
+        // Gaussian smoothing (sigma: 5 voxels), approximated by three box filters
+        useVolumeFilter(std::make_shared<GaussianFilter>(5.0f));
+
         auto model = std::make_shared<QuadraticFunctionModel>(2.0f, 1.5f, 0.5f);
         auto filter2 = std::make_shared<ModelApplicationFilter>(model);
         useVolumeFilter(filter2);
 
+        // multi-threaded execution (slab-wise); halo = reach of the filter in z-direction
+        useVolumeFilter(std::make_shared<SlabParallelFilter>(filter, filter->radius()));
+        useVolumeFilter(std::make_shared<SlabParallelFilter>(filter2, 0));
+
+        // chain of filters in a single (tiled) pass over the volume
+        auto pipeline = std::make_shared<VolumeFilterPipeline>();
+        pipeline->addFilter(filter2);
+        pipeline->addFilter(filter);
+        pipeline->addFilter(filter2);
+        useVolumeFilter(pipeline);
+
     }  catch (std::exception& err) {
         qCritical() << err.what();
     }
@@ -62,13 +87,48 @@ void useProjectionFilter()
     extrapolate.filter(projections);
     gui::plot(projections);
 
+    // arbitrary (e.g. collimator) masks: polygon or bitmap
+    projections.fill(1.0f);
+    MaskingFilter polygonMask(QPolygonF({ QPointF(250.0, 50.0), QPointF(450.0, 400.0), QPointF(50.0, 400.0) }));
+    polygonMask.filter(projections);
+    gui::plot(projections);
+
+    // compacted result: only the bounding box of the mask is stored
+    projections.fill(1.0f);
+    auto compacted = polygonMask.compact(projections);
+    qInfo() << "active fraction of the compacted projections:" << compacted.activeFraction();
+    gui::plot(compacted.toProjectionData());
+
+    // further processing of the compacted projections only touches the ROIs
+    mask.filterRoi(compacted);
+    gui::plot(extrapolate.expand(compacted)); // full size again, in a single pass
+    writeRoi(compacted, RawDataIO<500, 500, 10, float>(), "compacted_projections.raw");
+
     // serialization tests
     projections.fill(1.0f);
     testSerialization(mask, projections);
+    testSerialization(polygonMask, projections);
     testSerialization(extrapolate, projections);
 
 }
 
+void useStreamingFilter()
+{
+    auto setup = AcquisitionSetup(makeCTSystem<blueprints::GenericCarmCT>(DetectorBinning::Binning4x4), 100);
+    setup.applyPreparationProtocol(protocols::ShortScanTrajectory(700.0));
+    const auto volume = VoxelVolume<float>::cube(100, 1.0f, 0.02f);
+
+    // each block of 25 views is masked and extrapolated while the next block is projected
+    // (4 separate projections -> the volume is uploaded 4 times, see StreamingFilterExtension)
+    auto streaming = new StreamingFilterExtension(25);
+    streaming->addFilter(std::make_shared<MaskingFilter>(QRect(50, 40, 210, 160)));
+    streaming->addFilter(std::make_shared<LinearExtrapolationFilter>(QRect(50, 40, 210, 160)));
+
+    auto pipeline = makeProjector<ProjectionPipeline>(new OCL::RayCasterProjector());
+    pipeline->appendExtension(streaming);
+    gui::plot(pipeline->configureAndProject(setup, volume));
+}
+
 void useVolumeFilter(std::shared_ptr<CTL::AbstractVolumeFilter> volumeFilt)
 {
     auto volume = VoxelVolume<float>::cube(100, 1.0f, 0.0f);
@@ -0,0 +1,165 @@
+#include "roiprojectiondata.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+RoiProjectionData::RoiProjectionData(const CTL::ProjectionData& projections)
+    : m_dims(projections.dimensions())
+    , m_regions(m_dims.nbViews)
+{
+    ThreadPool::instance().run(m_dims.nbViews, [&] (size_t view) {
+        m_regions[view] = nonZeroBoundingBox(projections.view(static_cast<uint>(view)));
+    });
+
+    compactFrom(projections);
+}
+
+RoiProjectionData::RoiProjectionData(const CTL::ProjectionData& projections, std::vector<QRect> regions)
+    : m_dims(projections.dimensions())
+    , m_regions(std::move(regions))
+{
+    if(m_regions.size() != m_dims.nbViews)
+        throw std::domain_error("RoiProjectionData: number of regions does not match the number of views.");
+
+    const QRect moduleRect(0, 0, m_dims.nbChannels, m_dims.nbRows);
+    for(auto& region : m_regions)
+        region = region.intersected(moduleRect);
+
+    compactFrom(projections);
+}
+
+const CTL::ProjectionData::Dimensions& RoiProjectionData::dimensions() const
+{
+    return m_dims;
+}
+
+uint RoiProjectionData::nbViews() const
+{
+    return m_dims.nbViews;
+}
+
+const QRect& RoiProjectionData::region(uint view) const
+{
+    return m_regions[view];
+}
+
+float* RoiProjectionData::rawData(uint view)
+{
+    return m_data[view].data();
+}
+
+const float* RoiProjectionData::rawData(uint view) const
+{
+    return m_data[view].data();
+}
+
+size_t RoiProjectionData::nbActivePixels() const
+{
+    size_t ret = 0;
+    for(const auto& viewData : m_data)
+        ret += viewData.size();
+
+    return ret;
+}
+
+double RoiProjectionData::activeFraction() const
+{
+    const auto nbPixels = double(m_dims.nbChannels) * m_dims.nbRows * m_dims.nbModules * m_dims.nbViews;
+
+    return nbPixels > 0.0 ? double(nbActivePixels()) / nbPixels : 0.0;
+}
+
+CTL::ProjectionData RoiProjectionData::toProjectionData() const
+{
+    CTL::ProjectionData ret(m_dims.nbChannels, m_dims.nbRows, m_dims.nbModules);
+    ret.allocateMemory(m_dims.nbViews, 0.0f);
+
+    ThreadPool::instance().run(m_dims.nbViews, [&] (size_t view) {
+        expandView(static_cast<uint>(view), ret.view(static_cast<uint>(view)));
+    });
+
+    return ret;
+}
+
+CTL::SingleViewData RoiProjectionData::view(uint view) const
+{
+    CTL::SingleViewData ret(m_dims.nbChannels, m_dims.nbRows);
+    ret.allocateMemory(m_dims.nbModules, 0.0f);
+    expandView(view, ret);
+
+    return ret;
+}
+
+void RoiProjectionData::setView(uint view, const CTL::SingleViewData& data)
+{
+    if(data.dimensions().nbChannels != m_dims.nbChannels || data.dimensions().nbRows != m_dims.nbRows
+            || data.dimensions().nbModules != m_dims.nbModules)
+        throw std::domain_error("RoiProjectionData: dimensions of the view do not match.");
+
+    compactView(view, data);
+}
+
+void RoiProjectionData::compactFrom(const CTL::ProjectionData& projections)
+{
+    m_data.resize(m_dims.nbViews);
+
+    ThreadPool::instance().run(m_dims.nbViews, [&] (size_t view) {
+        const auto& region = m_regions[view];
+        m_data[view].resize(size_t(std::max(region.width(), 0)) * std::max(region.height(), 0) * m_dims.nbModules);
+        compactView(static_cast<uint>(view), projections.view(static_cast<uint>(view)));
+    });
+}
+
+// copies the ROI of 'data' (full size) into the compacted data of 'view'
+void RoiProjectionData::compactView(uint view, const CTL::SingleViewData& data)
+{
+    const auto& region = m_regions[view];
+    auto dst = m_data[view].data();
+    for(const auto& module : data.data())
+        for(int row = region.top(); row <= region.bottom(); ++row)
+        {
+            const auto src = module.rawData() + size_t(row) * m_dims.nbChannels + region.left();
+            dst = std::copy_n(src, region.width(), dst);
+        }
+}
+
+// copies the compacted data of 'view' into its ROI in 'data' (full size, pixels outside are not touched)
+void RoiProjectionData::expandView(uint view, CTL::SingleViewData& data) const
+{
+    const auto& region = m_regions[view];
+    auto src = m_data[view].data();
+    for(auto& module : data.data())
+        for(int row = region.top(); row <= region.bottom(); ++row)
+        {
+            std::copy_n(src, region.width(), module.rawData() + size_t(row) * m_dims.nbChannels + region.left());
+            src += region.width();
+        }
+}
+
+// union of the bounding boxes of all modules (empty if all pixels are zero)
+QRect RoiProjectionData::nonZeroBoundingBox(const CTL::SingleViewData& view)
+{
+    QRect ret;
+    for(const auto& module : view.data())
+    {
+        const auto nbChannels = module.width();
+        for(uint row = 0; row < module.height(); ++row)
+        {
+            const auto rowBegin = module.rawData() + size_t(row) * nbChannels;
+            const auto rowEnd = rowBegin + nbChannels;
+            const auto first = std::find_if(rowBegin, rowEnd, [] (float val) { return val != 0.0f; });
+            if(first == rowEnd)
+                continue;
+            const auto last = std::find_if(std::reverse_iterator<const float*>(rowEnd),
+                                           std::reverse_iterator<const float*>(first),
+                                           [] (float val) { return val != 0.0f; });
+
+            ret |= QRect(QPoint(int(first - rowBegin), int(row)),
+                         QPoint(int(last.base() - 1 - rowBegin), int(row)));
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,69 @@
+#ifndef ROIPROJECTIONDATA_H
+#define ROIPROJECTIONDATA_H
+
+#include "img/projectiondata.h"
+
+#include <QFile>
+#include <QRect>
+
+// RoiProjectionData
+// compacted projection data: only a rectangular region of interest (ROI) of each view is stored,
+// all pixels outside of it are zero (e.g. after masking, see MaskingFilter::compact())
+// -> the ROI is the same for all modules of a view, but may differ from view to view
+// -> the data of a view is stored module by module, row-major within the ROI
+// consumers that process the ROIs only:
+// -> AbstractViewFilter::filterRoi() (in place, e.g. MaskingFilter), LinearExtrapolationFilter::expand()
+//    (extrapolated full-size projections without expanding the compacted data first)
+// -> writeRoi(): raw file of the full size, only the ROI rows of each view are written
+// toProjectionData() restores the full projections for all other consumers
+class RoiProjectionData
+{
+public:
+    // ROI: bounding box of the non-zero pixels of each view
+    explicit RoiProjectionData(const CTL::ProjectionData& projections);
+    // ROI of each view given explicitly (clipped to the module), pixels outside are dropped
+    RoiProjectionData(const CTL::ProjectionData& projections, std::vector<QRect> regions);
+
+    const CTL::ProjectionData::Dimensions& dimensions() const;
+    uint nbViews() const;
+    const QRect& region(uint view) const;
+
+    float* rawData(uint view);
+    const float* rawData(uint view) const;
+
+    size_t nbActivePixels() const; // pixels inside the ROIs (all views and modules)
+    double activeFraction() const;
+
+    CTL::ProjectionData toProjectionData() const;
+    CTL::SingleViewData view(uint view) const; // full size, zero outside of the ROI
+    void setView(uint view, const CTL::SingleViewData& data); // keeps the ROI of the view only
+
+private:
+    void compactFrom(const CTL::ProjectionData& projections);
+    void compactView(uint view, const CTL::SingleViewData& data);
+    void expandView(uint view, CTL::SingleViewData& data) const;
+    static QRect nonZeroBoundingBox(const CTL::SingleViewData& view);
+
+    CTL::ProjectionData::Dimensions m_dims;
+    std::vector<QRect> m_regions;
+    std::vector<std::vector<float>> m_data;
+};
+
+// writes compacted projections to a raw file of the full projection size, only the ROI rows of
+// each view are written (the rest of the new file stays zero, sparse on most file systems)
+// RawIO: RawDataIO<nbChannels, nbRows, nbModules * nbViews, RawType> (see TutorialA3/rawdataio.h)
+template<typename RawIO>
+bool writeRoi(const RoiProjectionData& projections, const RawIO& io, const QString& fileName)
+{
+    QFile::remove(fileName);
+
+    const auto nbModules = projections.dimensions().nbModules;
+    for(uint view = 0; view < projections.nbViews(); ++view)
+        if(!io.writeRegion(projections.rawData(view), projections.region(view), fileName,
+                           view * nbModules, nbModules))
+            return false;
+
+    return true;
+}
+
+#endif // ROIPROJECTIONDATA_H
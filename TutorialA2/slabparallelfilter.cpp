@@ -0,0 +1,121 @@
+#include "slabparallelfilter.h"
+#include "threadpool.h"
+
+#include "img/voxelvolume.h"
+#include "io/serializationhelper.h"
+
+#include <QDebug>
+
+DECLARE_SERIALIZABLE_TYPE(SlabParallelFilter)
+
+SlabParallelFilter::SlabParallelFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter, uint halo,
+                                       uint slabThickness)
+    : m_filter(std::move(filter))
+    , m_halo(halo)
+    , m_slabThickness(slabThickness)
+{
+}
+
+void SlabParallelFilter::filter(CTL::VoxelVolume<float>& volume)
+{
+    if(!m_filter)
+    {
+        qCritical() << "Could not apply SlabParallelFilter. No nested filter has been set.";
+        return;
+    }
+
+    const auto dim = volume.dimensions();
+    const auto voxSize = volume.voxelSize();
+    const auto sliceSize = size_t(dim.x) * dim.y;
+    const auto thickness = slabThickness(dim.z);
+    const auto nbSlabs = (dim.z + thickness - 1) / thickness;
+
+    const auto slabBegin = [thickness] (size_t slab) { return static_cast<uint>(slab) * thickness; };
+    const auto slabEnd = [thickness, &dim] (size_t slab) {
+        return std::min(static_cast<uint>(slab + 1) * thickness, dim.z);
+    };
+
+    auto& pool = ThreadPool::instance();
+
+    // the halo of a slab is part of its neighbors, which are overwritten concurrently
+    // -> copy all halo slices before any slab gets processed
+    std::vector<std::vector<float>> lowerHalos(nbSlabs), upperHalos(nbSlabs);
+    if(m_halo > 0)
+    {
+        pool.run(nbSlabs, [&] (size_t slab) {
+            const auto zBegin = slabBegin(slab);
+            const auto zEnd = slabEnd(slab);
+            const auto nbLower = std::min(m_halo, zBegin);
+            const auto nbUpper = std::min(m_halo, dim.z - zEnd);
+
+            const auto data = volume.rawData();
+            lowerHalos[slab].assign(data + (zBegin - nbLower) * sliceSize, data + zBegin * sliceSize);
+            upperHalos[slab].assign(data + zEnd * sliceSize, data + (zEnd + nbUpper) * sliceSize);
+        });
+    }
+
+    pool.run(nbSlabs, [&] (size_t slab) {
+        const auto zBegin = slabBegin(slab);
+        const auto zEnd = slabEnd(slab);
+        const auto nbLower = static_cast<uint>(lowerHalos[slab].size() / sliceSize);
+        const auto nbUpper = static_cast<uint>(upperHalos[slab].size() / sliceSize);
+        const auto innerBegin = volume.rawData() + zBegin * sliceSize;
+        const auto innerEnd = volume.rawData() + zEnd * sliceSize;
+
+        CTL::VoxelVolume<float> slabVolume(dim.x, dim.y, nbLower + (zEnd - zBegin) + nbUpper,
+                                           voxSize.x, voxSize.y, voxSize.z);
+        slabVolume.allocateMemory();
+
+        auto dst = slabVolume.rawData();
+        dst = std::copy(lowerHalos[slab].cbegin(), lowerHalos[slab].cend(), dst);
+        dst = std::copy(innerBegin, innerEnd, dst);
+        std::copy(upperHalos[slab].cbegin(), upperHalos[slab].cend(), dst);
+
+        m_filter->filter(slabVolume);
+
+        const auto filteredInner = slabVolume.rawData() + nbLower * sliceSize;
+        std::copy(filteredInner, filteredInner + (innerEnd - innerBegin), innerBegin);
+    });
+}
+
+uint SlabParallelFilter::slabThickness(uint nbSlices) const
+{
+    if(m_slabThickness > 0)
+        return m_slabThickness;
+
+    // several slabs per thread allow work stealing to balance slabs of different cost;
+    // slabs thinner than the halo would mainly process halo slices
+    const auto nbSlabs = 4u * ThreadPool::instance().nbThreads();
+
+    return std::max({ (nbSlices + nbSlabs - 1) / nbSlabs, m_halo, 1u });
+}
+
+QVariant SlabParallelFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("filter", m_filter ? m_filter->toVariant() : QVariant());
+    parMap.insert("halo", m_halo);
+    parMap.insert("slab thickness", m_slabThickness);
+
+    return parMap;
+}
+
+void SlabParallelFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("filter"))
+    {
+        auto nestedFilter = CTL::SerializationHelper::parseMiscObject(parMap.value("filter"));
+        m_filter.reset(dynamic_cast<CTL::AbstractVolumeFilter*>(nestedFilter));
+        if(nestedFilter && !m_filter)
+            delete nestedFilter;
+    }
+    if(parMap.contains("halo"))
+        m_halo = parMap.value("halo").toUInt();
+    if(parMap.contains("slab thickness"))
+        m_slabThickness = parMap.value("slab thickness").toUInt();
+}
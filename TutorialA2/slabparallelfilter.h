@@ -0,0 +1,38 @@
+#ifndef SLABPARALLELFILTER_H
+#define SLABPARALLELFILTER_H
+
+#include "processing/abstractvolumefilter.h"
+
+// SlabParallelFilter
+// applies a (nested) volume filter slab by slab on all threads of the ThreadPool:
+// the volume is split into z-slabs, each slab is extended by 'halo' slices on both sides,
+// filtered as a separate volume and its inner part is written back
+// -> 'halo' must be at least the reach of the nested filter in z-direction
+//    (e.g. 0 for point-wise filters, the radius for a MovingAverageFilter)
+// -> the nested filter must support concurrent calls of filter() on different volumes
+class SlabParallelFilter : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 6)
+
+public:
+    SlabParallelFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter, uint halo,
+                       uint slabThickness = 0); // 0: automatic choice from volume size and number of threads
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    SlabParallelFilter() = default;
+
+    uint slabThickness(uint nbSlices) const;
+
+    std::shared_ptr<CTL::AbstractVolumeFilter> m_filter;
+    uint m_halo = 0;
+    uint m_slabThickness = 0;
+};
+
+#endif // SLABPARALLELFILTER_H
@@ -0,0 +1,143 @@
+#include "streamingfilterextension.h"
+#include "threadpool.h"
+
+#include "io/serializationhelper.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <future>
+
+DECLARE_SERIALIZABLE_TYPE(StreamingFilterExtension)
+
+StreamingFilterExtension::StreamingFilterExtension(uint viewsPerBlock)
+    : m_viewsPerBlock(viewsPerBlock)
+{
+}
+
+void StreamingFilterExtension::configure(const CTL::AcquisitionSetup& setup)
+{
+    m_setup = setup;
+    ProjectorExtension::configure(setup);
+}
+
+bool StreamingFilterExtension::isLinear() const
+{
+    return m_filters.empty() && ProjectorExtension::isLinear();
+}
+
+void StreamingFilterExtension::addFilter(std::shared_ptr<AbstractViewFilter> filter)
+{
+    if(!filter)
+    {
+        qWarning() << "StreamingFilterExtension: null filter ignored.";
+        return;
+    }
+
+    m_filters.push_back(std::move(filter));
+}
+
+uint StreamingFilterExtension::nbFilters() const
+{
+    return static_cast<uint>(m_filters.size());
+}
+
+CTL::ProjectionData StreamingFilterExtension::extendedProject(const MetaProjector& nestedProjector)
+{
+    const auto nbViews = m_setup.nbViews();
+    if(m_filters.empty() || m_viewsPerBlock == 0 || nbViews <= m_viewsPerBlock)
+    {
+        auto projections = nestedProjector.project();
+        filterBlock(projections);
+        return projections;
+    }
+
+    // the block is declared before the future: if project() throws, ~future waits for the task
+    // that filters the block before the block is destroyed
+    CTL::ProjectionData ret(0, 0, 0);
+    CTL::ProjectionData pendingBlock(0, 0, 0);
+    std::future<void> pendingFilter;
+
+    // appends the filtered block (the one from the previous iteration) to the result
+    const auto collect = [&ret, &pendingFilter, &pendingBlock] {
+        if(!pendingFilter.valid())
+            return;
+        pendingFilter.get();
+        if(ret.nbViews() == 0)
+            ret = CTL::ProjectionData(pendingBlock.viewDimensions());
+        for(auto& view : pendingBlock.data())
+            ret.append(std::move(view));
+    };
+
+    for(uint firstView = 0; firstView < nbViews; firstView += m_viewsPerBlock)
+    {
+        auto blockSetup = m_setup;
+        blockSetup.removeAllViews();
+        for(uint view = firstView; view < std::min(firstView + m_viewsPerBlock, nbViews); ++view)
+            blockSetup.addView(m_setup.view(view));
+
+        ProjectorExtension::configure(blockSetup);
+        auto block = nestedProjector.project();
+
+        collect();
+
+        emit notifier()->information("StreamingFilterExtension: filtering views " + QString::number(firstView)
+                                     + " to " + QString::number(firstView + block.nbViews() - 1) + ".");
+        pendingBlock = std::move(block);
+        pendingFilter = std::async(std::launch::async, [this, &pendingBlock] { filterBlock(pendingBlock); });
+    }
+    collect();
+
+    // restore the full configuration of the nested projector
+    ProjectorExtension::configure(m_setup);
+
+    return ret;
+}
+
+void StreamingFilterExtension::filterBlock(CTL::ProjectionData& block) const
+{
+    ThreadPool::instance().run(block.nbViews(), [this, &block] (size_t view) {
+        for(const auto& filter : m_filters)
+            filter->filterView(block.view(static_cast<uint>(view)));
+    });
+}
+
+QVariant StreamingFilterExtension::parameter() const
+{
+    auto parMap = ProjectorExtension::parameter().toMap();
+
+    QVariantList filters;
+    for(const auto& filter : m_filters)
+        filters.append(filter->toVariant());
+
+    parMap.insert("filters", filters);
+    parMap.insert("views per block", m_viewsPerBlock);
+
+    return parMap;
+}
+
+void StreamingFilterExtension::setParameter(const QVariant& parameter)
+{
+    ProjectorExtension::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("filters"))
+    {
+        m_filters.clear();
+        for(const auto& filterVar : parMap.value("filters").toList())
+        {
+            auto nestedFilter = CTL::SerializationHelper::parseMiscObject(filterVar);
+            std::shared_ptr<AbstractViewFilter> filter(dynamic_cast<AbstractViewFilter*>(nestedFilter));
+            if(!filter)
+            {
+                delete nestedFilter;
+                qWarning() << "StreamingFilterExtension: could not parse filter.";
+                continue;
+            }
+            addFilter(std::move(filter));
+        }
+    }
+    if(parMap.contains("views per block"))
+        m_viewsPerBlock = parMap.value("views per block").toUInt();
+}
@@ -0,0 +1,52 @@
+#ifndef STREAMINGFILTEREXTENSION_H
+#define STREAMINGFILTEREXTENSION_H
+
+#include "abstractviewfilter.h"
+
+#include "acquisition/acquisitionsetup.h"
+#include "projectors/projectorextension.h"
+
+// StreamingFilterExtension
+// applies a chain of view filters (see AbstractViewFilter) to the projections, overlapping the
+// filtering with the projection block by block:
+// -> this is not a per-view stream: ProjectorNotifier::projectionFinished only reports the index of
+//    a finished view, its data is not available before project() returns; instead, the views are
+//    projected in blocks of 'viewsPerBlock' views by separate projections, and while the nested
+//    projector computes the next block, the previous block is filtered on a worker thread
+// -> each block is filtered right after its projection, the result contains filtered views only
+//    (no unfiltered copy of the entire projection data is held)
+// -> viewsPerBlock = 0: a single projection of all views, filtered afterwards (no overlap)
+// note: the nested projector is configured with the views of the current block only, i.e.
+//       its notifier reports view indices relative to the block
+// cost: each block is a separate configure() + project() of the nested projector; e.g. the
+// OCL::RayCasterProjector re-initializes and uploads the entire volume for every block (the CTL
+// projectors cannot project a subset of the configured views), so blocks should be large enough
+// that this overhead stays well below the filter time hidden per block (a few blocks in total)
+class StreamingFilterExtension : public CTL::ProjectorExtension
+{
+    CTL_TYPE_ID(CTL::ProjectorExtension::UserType + 202)
+
+public:
+    explicit StreamingFilterExtension(uint viewsPerBlock = 64);
+
+    void configure(const CTL::AcquisitionSetup& setup) override;
+    bool isLinear() const override;
+
+    void addFilter(std::shared_ptr<AbstractViewFilter> filter);
+    uint nbFilters() const;
+
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+protected:
+    CTL::ProjectionData extendedProject(const MetaProjector& nestedProjector) override;
+
+private:
+    void filterBlock(CTL::ProjectionData& block) const;
+
+    std::vector<std::shared_ptr<AbstractViewFilter>> m_filters;
+    uint m_viewsPerBlock;
+    CTL::AcquisitionSetup m_setup;
+};
+
+#endif // STREAMINGFILTEREXTENSION_H
@@ -0,0 +1,152 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace {
+thread_local const ThreadPool* currentPool = nullptr;
+}
+
+ThreadPool::ThreadPool(uint nbThreads)
+{
+    if(nbThreads == 0)
+        nbThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for(uint t = 0; t < nbThreads; ++t)
+        m_queues.emplace_back(new TaskQueue);
+
+    for(uint t = 0; t < nbThreads; ++t)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, t);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for(auto& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::run(size_t nbTasks, std::function<void(size_t)> task)
+{
+    if(nbTasks == 0)
+        return;
+
+    // nested call (or trivial job) -> no need to involve the workers
+    if(currentPool == this || nbTasks == 1)
+    {
+        for(size_t i = 0; i < nbTasks; ++i)
+            task(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    m_task = std::move(task);
+    m_error = nullptr;
+    m_remainingTasks = nbTasks;
+
+    // contiguous blocks of tasks per worker (neighboring tasks often share cache lines/pages)
+    const auto nbQueues = m_queues.size();
+    for(size_t q = 0; q < nbQueues; ++q)
+    {
+        std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+        for(size_t i = q * nbTasks / nbQueues; i < (q + 1) * nbTasks / nbQueues; ++i)
+            m_queues[q]->tasks.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_jobId;
+    }
+    m_jobAvailable.notify_all();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobFinished.wait(lock, [this] { return m_remainingTasks == 0; });
+
+    m_task = nullptr;
+    if(m_error)
+        std::rethrow_exception(m_error);
+}
+
+uint ThreadPool::nbThreads() const
+{
+    return static_cast<uint>(m_threads.size());
+}
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop(uint workerId)
+{
+    currentPool = this;
+    unsigned long long lastJobId = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this, lastJobId] { return m_stop || m_jobId != lastJobId; });
+            if(m_stop)
+                return;
+            lastJobId = m_jobId;
+        }
+
+        size_t task;
+        while(popTask(workerId, task) || stealTask(workerId, task))
+            execute(task);
+    }
+}
+
+bool ThreadPool::popTask(uint workerId, size_t& task)
+{
+    auto& queue = *m_queues[workerId];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty())
+        return false;
+
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::stealTask(uint workerId, size_t& task)
+{
+    const auto nbQueues = static_cast<uint>(m_queues.size());
+    for(uint offset = 1; offset < nbQueues; ++offset)
+    {
+        auto& victim = *m_queues[(workerId + offset) % nbQueues];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(size_t task)
+{
+    try {
+        m_task(task);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_error)
+            m_error = std::current_exception();
+    }
+
+    if(--m_remainingTasks == 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobFinished.notify_all();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QtGlobal>
+
+// ThreadPool
+// pool of persistent worker threads with one task queue per worker; tasks of a job are
+// distributed in contiguous blocks and idle workers steal from the back of other queues,
+// so that jobs with unevenly expensive tasks are still balanced
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint nbThreads = 0); // 0: one thread per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // runs task(i) for all i in [0, nbTasks) and returns when all of them have finished;
+    // the first exception thrown by a task is rethrown here
+    // (calls from within a task of this pool are executed sequentially by the calling thread)
+    void run(size_t nbTasks, std::function<void(size_t)> task);
+
+    uint nbThreads() const;
+
+    static ThreadPool& instance();
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void workerLoop(uint workerId);
+    bool popTask(uint workerId, size_t& task);
+    bool stealTask(uint workerId, size_t& task);
+    void execute(size_t task);
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+
+    std::function<void(size_t)> m_task;
+    std::atomic<size_t> m_remainingTasks{ 0 };
+    std::exception_ptr m_error;
+
+    std::mutex m_runMutex; // serializes concurrent calls of run()
+    std::mutex m_mutex;    // protects the job state below
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobFinished;
+    unsigned long long m_jobId = 0;
+    bool m_stop = false;
+};
+
+#endif // THREADPOOL_H
@@ -9,11 +9,21 @@ include(../../ctl/modules/ctl.pri)
 include(../../ctl/modules/ctl_ocl.pri)
 include(../../ctl/modules/ctl_qtgui.pri)
 
+# raw file IO (RawDataIO, see roiprojectiondata.h)
+INCLUDEPATH += ../TutorialA3
+
 SOURCES += \
+        abstractviewfilter.cpp \
+        batchdatamodel.cpp \
         custommodels.cpp \
         customprojectionfilters.cpp \
         customvolumefilters.cpp \
-        main.cpp
+        main.cpp \
+        roiprojectiondata.cpp \
+        slabparallelfilter.cpp \
+        streamingfilterextension.cpp \
+        threadpool.cpp \
+        volumefilterpipeline.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -21,6 +31,14 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    ../TutorialA3/rawdataio.h \
+    abstractviewfilter.h \
+    batchdatamodel.h \
     custommodels.h \
     customprojectionfilters.h \
-    customvolumefilters.h
+    customvolumefilters.h \
+    roiprojectiondata.h \
+    slabparallelfilter.h \
+    streamingfilterextension.h \
+    threadpool.h \
+    volumefilterpipeline.h
@@ -0,0 +1,227 @@
+#include "volumefilterpipeline.h"
+#include "customvolumefilters.h"
+#include "threadpool.h"
+
+#include "img/voxelvolume.h"
+#include "io/serializationhelper.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+DECLARE_SERIALIZABLE_TYPE(VolumeFilterPipeline)
+
+constexpr int VolumeFilterPipeline::NonLocal;
+
+namespace {
+
+int detectHalo(const CTL::AbstractVolumeFilter& filter)
+{
+    if(const auto movingAverage = dynamic_cast<const MovingAverageFilter*>(&filter))
+        return static_cast<int>(movingAverage->radius());
+    if(const auto gaussian = dynamic_cast<const GaussianFilter*>(&filter))
+        return static_cast<int>(gaussian->reach());
+    if(dynamic_cast<const ModelApplicationFilter*>(&filter))
+        return 0;
+
+    return VolumeFilterPipeline::NonLocal;
+}
+
+} // unnamed namespace
+
+VolumeFilterPipeline::VolumeFilterPipeline(size_t cacheSize)
+    : m_cacheSize(cacheSize)
+{
+}
+
+void VolumeFilterPipeline::filter(CTL::VoxelVolume<float>& volume)
+{
+    auto segmentBegin = m_stages.cbegin();
+    for(auto stage = m_stages.cbegin(); ; ++stage)
+    {
+        if(stage != m_stages.cend() && stage->halo != NonLocal)
+            continue;
+
+        if(segmentBegin != stage)
+            filterTiled(volume, segmentBegin, stage);
+        if(stage == m_stages.cend())
+            break;
+
+        stage->filter->filter(volume);
+        segmentBegin = stage + 1;
+    }
+}
+
+void VolumeFilterPipeline::addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter)
+{
+    if(!filter)
+    {
+        qWarning() << "VolumeFilterPipeline: null filter ignored.";
+        return;
+    }
+
+    const auto halo = detectHalo(*filter);
+    addFilter(std::move(filter), halo);
+}
+
+void VolumeFilterPipeline::addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter, int halo)
+{
+    if(!filter)
+    {
+        qWarning() << "VolumeFilterPipeline: null filter ignored.";
+        return;
+    }
+
+    m_stages.push_back({ std::move(filter), std::max(halo, NonLocal) });
+}
+
+uint VolumeFilterPipeline::nbFilters() const
+{
+    return static_cast<uint>(m_stages.size());
+}
+
+// runs the stages [first, last) (all local) tile by tile;
+// the volume is traversed in bands of z-slices, all tiles of a band are processed in parallel
+// and written back afterwards; the original slices below the current band that are still
+// required as halo are kept in 'lowerHalo'
+void VolumeFilterPipeline::filterTiled(CTL::VoxelVolume<float>& volume, StageIterator first,
+                                       StageIterator last) const
+{
+    const auto dim = volume.dimensions();
+    const auto voxSize = volume.voxelSize();
+    const auto sliceSize = size_t(dim.x) * dim.y;
+
+    uint halo = 0;
+    for(auto stage = first; stage != last; ++stage)
+        halo += static_cast<uint>(stage->halo);
+
+    const auto tile = tileSize(dim.x, halo);
+    const auto nbTilesY = (dim.y + tile - 1) / tile;
+
+    auto& pool = ThreadPool::instance();
+    std::vector<float> lowerHalo;
+    std::vector<std::vector<float>> results(nbTilesY);
+
+    for(uint z0 = 0; z0 < dim.z; z0 += tile)
+    {
+        const auto z1 = std::min(z0 + tile, dim.z);
+        const auto nbLower = std::min(halo, z0);
+        const auto nbUpper = std::min(halo, dim.z - z1);
+        const auto nbSlices = nbLower + (z1 - z0) + nbUpper;
+
+        pool.run(nbTilesY, [&] (size_t tileY) {
+            const auto y0 = static_cast<uint>(tileY) * tile;
+            const auto y1 = std::min(y0 + tile, dim.y);
+            const auto yBegin = y0 - std::min(halo, y0);
+            const auto yEnd = y1 + std::min(halo, dim.y - y1);
+            const auto tileSliceSize = size_t(yEnd - yBegin) * dim.x;
+
+            CTL::VoxelVolume<float> tileVolume(dim.x, yEnd - yBegin, nbSlices, voxSize.x, voxSize.y, voxSize.z);
+            tileVolume.allocateMemory();
+
+            auto dst = tileVolume.rawData();
+            for(uint s = 0; s < nbSlices; ++s)
+            {
+                const auto slice = s < nbLower ? lowerHalo.data() + s * sliceSize
+                                               : volume.rawData() + (z0 - nbLower + s) * sliceSize;
+                dst = std::copy(slice + yBegin * dim.x, slice + yEnd * dim.x, dst);
+            }
+
+            for(auto stage = first; stage != last; ++stage)
+                stage->filter->filter(tileVolume);
+
+            // keep the inner part until all tiles of this band are done
+            const auto innerRow = size_t(y1 - y0) * dim.x;
+            auto& result = results[tileY];
+            result.resize((z1 - z0) * innerRow);
+            for(uint z = z0; z < z1; ++z)
+            {
+                const auto src = tileVolume.rawData() + (z - z0 + nbLower) * tileSliceSize
+                                                      + (y0 - yBegin) * dim.x;
+                std::copy(src, src + innerRow, result.data() + (z - z0) * innerRow);
+            }
+        });
+
+        // original slices required as lower halo for the next band (possibly from the current halo)
+        if(z1 < dim.z)
+        {
+            const auto nbNextLower = std::min(halo, z1);
+            std::vector<float> nextLowerHalo(nbNextLower * sliceSize);
+            for(uint z = z1 - nbNextLower; z < z1; ++z)
+            {
+                const auto slice = z < z0 ? lowerHalo.data() + (z - (z0 - nbLower)) * sliceSize
+                                          : volume.rawData() + z * sliceSize;
+                std::copy(slice, slice + sliceSize, nextLowerHalo.data() + (z - (z1 - nbNextLower)) * sliceSize);
+            }
+            lowerHalo.swap(nextLowerHalo);
+        }
+
+        pool.run(nbTilesY, [&] (size_t tileY) {
+            const auto y0 = static_cast<uint>(tileY) * tile;
+            const auto innerRow = size_t(std::min(y0 + tile, dim.y) - y0) * dim.x;
+            for(uint z = z0; z < z1; ++z)
+            {
+                const auto src = results[tileY].data() + (z - z0) * innerRow;
+                std::copy(src, src + innerRow, volume.rawData() + z * sliceSize + y0 * dim.x);
+            }
+        });
+    }
+}
+
+// edge length (y and z) of the inner part of a tile, such that a tile incl. its halo takes up
+// half of the cache (the other half is left for the filters' scratch memory)
+uint VolumeFilterPipeline::tileSize(uint rowLength, uint halo) const
+{
+    const auto tileElements = double(m_cacheSize) / (2.0 * sizeof(float));
+    const auto edge = static_cast<int>(std::sqrt(tileElements / rowLength)) - 2 * static_cast<int>(halo);
+
+    // tiles thinner than the halo would mainly process halo voxels
+    return std::max({ edge, static_cast<int>(halo), 1 });
+}
+
+QVariant VolumeFilterPipeline::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    QVariantList filters;
+    for(const auto& stage : m_stages)
+    {
+        QVariantMap stageMap;
+        stageMap.insert("filter", stage.filter->toVariant());
+        stageMap.insert("halo", stage.halo);
+        filters.append(stageMap);
+    }
+
+    parMap.insert("filters", filters);
+    parMap.insert("cache size", static_cast<qulonglong>(m_cacheSize));
+
+    return parMap;
+}
+
+void VolumeFilterPipeline::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("filters"))
+    {
+        m_stages.clear();
+        for(const auto& stageVar : parMap.value("filters").toList())
+        {
+            const auto stageMap = stageVar.toMap();
+            auto nestedFilter = CTL::SerializationHelper::parseMiscObject(stageMap.value("filter"));
+            std::shared_ptr<CTL::AbstractVolumeFilter> filter(dynamic_cast<CTL::AbstractVolumeFilter*>(nestedFilter));
+            if(!filter)
+            {
+                delete nestedFilter;
+                qWarning() << "VolumeFilterPipeline: could not parse filter.";
+                continue;
+            }
+            addFilter(std::move(filter), stageMap.value("halo").toInt());
+        }
+    }
+    if(parMap.contains("cache size"))
+        m_cacheSize = static_cast<size_t>(parMap.value("cache size").toULongLong());
+}
@@ -0,0 +1,53 @@
+#ifndef VOLUMEFILTERPIPELINE_H
+#define VOLUMEFILTERPIPELINE_H
+
+#include "processing/abstractvolumefilter.h"
+
+// VolumeFilterPipeline
+// applies a chain of volume filters tile by tile, such that each tile passes through all filters
+// while it resides in cache (instead of one pass over the entire volume per filter):
+// -> the volume is split into tiles in y- and z-direction (full rows in x), each tile is extended
+//    by the summed halo of all filters and sized to fit into 'cacheSize' bytes
+// -> point-wise filters (halo 0) are thus fused with their neighboring stencil filters
+// -> tiles are processed on all threads of the ThreadPool; the filters must support concurrent
+//    calls of filter() on different volumes
+// filters with a halo of 'NonLocal' (e.g. filters depending on the entire volume) split the
+// chain: they are applied to the entire volume in between the tiled parts of the chain
+// the halo is determined automatically for MovingAverageFilter (radius), GaussianFilter (reach)
+// and ModelApplicationFilter (0), unknown filters are considered non-local unless specified
+class VolumeFilterPipeline : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 7)
+
+public:
+    static constexpr int NonLocal = -1;
+
+    explicit VolumeFilterPipeline(size_t cacheSize = 1024 * 1024);
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+
+    void addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter);
+    void addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter, int halo);
+    uint nbFilters() const;
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    struct Stage
+    {
+        std::shared_ptr<CTL::AbstractVolumeFilter> filter;
+        int halo;
+    };
+    using StageIterator = std::vector<Stage>::const_iterator;
+
+    void filterTiled(CTL::VoxelVolume<float>& volume, StageIterator first, StageIterator last) const;
+    uint tileSize(uint rowLength, uint halo) const;
+
+    std::vector<Stage> m_stages;
+    size_t m_cacheSize;
+};
+
+#endif // VOLUMEFILTERPIPELINE_H
@@ -0,0 +1,25 @@
+#include "asyncfilter.h"
+
+// (the data is held by a shared_ptr, since C++11 lambdas cannot capture by move)
+
+std::future<CTL::VoxelVolume<float>> filterAsync(std::shared_ptr<CTL::AbstractVolumeFilter> filter,
+                                                 CTL::VoxelVolume<float> volume, SerialExecutor& executor)
+{
+    auto data = std::make_shared<CTL::VoxelVolume<float>>(std::move(volume));
+
+    return executor.submit([filter, data] {
+        filter->filter(*data);
+        return std::move(*data);
+    });
+}
+
+std::future<CTL::ProjectionData> filterAsync(std::shared_ptr<CTL::AbstractProjectionFilter> filter,
+                                             CTL::ProjectionData projections, SerialExecutor& executor)
+{
+    auto data = std::make_shared<CTL::ProjectionData>(std::move(projections));
+
+    return executor.submit([filter, data] {
+        filter->filter(*data);
+        return std::move(*data);
+    });
+}
@@ -0,0 +1,28 @@
+#ifndef ASYNCFILTER_H
+#define ASYNCFILTER_H
+
+#include "serialexecutor.h"
+
+#include "img/projectiondata.h"
+#include "img/voxelvolume.h"
+#include "processing/abstractprojectionfilter.h"
+#include "processing/abstractvolumefilter.h"
+
+// filterAsync
+// non-blocking application of a filter, in particular of the OpenCL filters (GenericOCLVolumeFilter,
+// GenericOCLProjectionFilter, VolumeSegmentationFilter, ...), such that the calling thread can load
+// the next dataset or do CPU work in the meantime:
+// -> the data is moved into the call and handed back by the future once it has been filtered
+// -> the filter runs on the worker thread of 'executor'; the default executor is shared by all
+//    filters, i.e. all calls are executed one after another in submission order
+// -> exceptions thrown by the filter are rethrown by future::get(); note that the OpenCL filters of
+//    the CTL and of this tutorial do not throw on OpenCL errors, they catch cl::Error and only log
+//    it (qCritical), i.e. future::get() then returns the unfiltered or partially filtered data
+std::future<CTL::VoxelVolume<float>> filterAsync(std::shared_ptr<CTL::AbstractVolumeFilter> filter,
+                                                 CTL::VoxelVolume<float> volume,
+                                                 SerialExecutor& executor = SerialExecutor::instance());
+std::future<CTL::ProjectionData> filterAsync(std::shared_ptr<CTL::AbstractProjectionFilter> filter,
+                                             CTL::ProjectionData projections,
+                                             SerialExecutor& executor = SerialExecutor::instance());
+
+#endif // ASYNCFILTER_H
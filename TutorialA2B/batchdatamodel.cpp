@@ -0,0 +1,19 @@
+#include "batchdatamodel.h"
+
+void AbstractBatchDataModel::valuesAt(const float* positions, float* values, size_t count) const
+{
+    for(size_t i = 0; i < count; ++i)
+        values[i] = valueAt(positions[i]);
+}
+
+void evaluateBatch(const CTL::AbstractDataModel& model, const float* positions, float* values, size_t count)
+{
+    if(const auto batchModel = dynamic_cast<const AbstractBatchDataModel*>(&model))
+    {
+        batchModel->valuesAt(positions, values, count);
+        return;
+    }
+
+    for(size_t i = 0; i < count; ++i)
+        values[i] = model.valueAt(positions[i]);
+}
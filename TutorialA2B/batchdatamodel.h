@@ -0,0 +1,21 @@
+#ifndef BATCHDATAMODEL_H
+#define BATCHDATAMODEL_H
+
+#include "models/abstractdatamodel.h"
+
+// AbstractBatchDataModel
+// data model that can evaluate an entire array of positions in one call
+// -> sub-classes override valuesAt() with a vectorized implementation
+class AbstractBatchDataModel : public CTL::AbstractDataModel
+{
+public:
+    // computes values[i] = valueAt(positions[i]) for all i in [0, count)
+    // (positions and values may point to the same memory)
+    virtual void valuesAt(const float* positions, float* values, size_t count) const;
+};
+
+// batch evaluation of an arbitrary data model
+// -> uses AbstractBatchDataModel::valuesAt() if available, otherwise calls valueAt() per element
+void evaluateBatch(const CTL::AbstractDataModel& model, const float* positions, float* values, size_t count);
+
+#endif // BATCHDATAMODEL_H
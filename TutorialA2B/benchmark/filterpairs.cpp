@@ -0,0 +1,289 @@
+#include "filterpairs.h"
+
+#include "ctl.h"
+#include "ctl_ocl.h"
+
+#include "customoclprojectionfilters.h"
+#include "customoclvolumefilters.h"
+#include "customprojectionfilters.h"
+#include "customvolumefilters.h"
+#include "oclprogramcache.h"
+
+#include <QDebug>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// number of views of the projection data (the size is the edge length of the detector)
+const uint NB_VIEWS = 64;
+
+template <class Filter>
+struct FilterPair
+{
+    QString cpuFilter;
+    QString oclFilter;
+    std::function<std::shared_ptr<Filter>(uint size)> makeCpu;
+    std::function<std::shared_ptr<Filter>(uint size)> makeOcl;
+    float tolerance;
+    double maxMismatchFraction;
+};
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+std::shared_ptr<CTL::AbstractDataModel> segmentationModel(const std::vector<float>& thresholds)
+{
+    // value i + 1 above threshold i (same as volumesegementationfilter_flexible.cl)
+    std::shared_ptr<CTL::AbstractDataModel> ret = std::make_shared<CTL::ConstantModel>(0.0f);
+    for(size_t i = 0; i < thresholds.size(); ++i)
+    {
+        const auto upper = i + 1 < thresholds.size() ? thresholds[i + 1] : std::numeric_limits<float>::max();
+        ret = ret + std::make_shared<CTL::RectFunctionModel>(thresholds[i], upper, float(i + 1));
+    }
+
+    return ret;
+}
+
+std::vector<FilterPair<CTL::AbstractVolumeFilter>> volumePairs(const std::string& clPath)
+{
+    const auto fixedThresholds = std::vector<float>{ 0.2f, 0.9f, 1.0f };
+    const auto thresholds = std::vector<float>{ 0.1f, 0.25f, 0.5f, 0.9f, 1.0f };
+    const auto fixedModel = segmentationModel({ 0.2f, 0.9f });
+    const auto model = segmentationModel(thresholds);
+
+    return {
+        { "ModelApplicationFilter", "GenericOCLVolumeFilter(volumesegmentationfilter.cl)",
+          [fixedModel] (uint) { return std::make_shared<ModelApplicationFilter>(fixedModel); },
+          [clPath, fixedThresholds] (uint) {
+              return std::make_shared<CTL::OCL::GenericOCLVolumeFilter>(
+                          OCLProgramCache::clFilePath(clPath + "volumesegmentationfilter.cl"), fixedThresholds); },
+          0.0f, 1.0e-6 },
+        { "ModelApplicationFilter", "VolumeSegmentationFilter",
+          [model] (uint) { return std::make_shared<ModelApplicationFilter>(model); },
+          [thresholds] (uint) { return std::make_shared<VolumeSegmentationFilter>(thresholds); },
+          0.0f, 1.0e-6 },
+        { "MovingAverageFilter(2)", "OCLMovingAverageFilter(2)",
+          [] (uint) { return std::make_shared<MovingAverageFilter>(2); },
+          [] (uint) { return std::make_shared<OCLMovingAverageFilter>(2); },
+          1.0e-5f, 0.0 },
+    };
+}
+
+std::vector<FilterPair<CTL::AbstractProjectionFilter>> projectionPairs(const std::string& clPath)
+{
+    // mask: centered rectangle of half the detector size
+    const auto mask = [] (uint size) { return QRect(size / 4, size / 4, size / 2, size / 2); };
+    const auto maskArguments = [mask] (uint size) {
+        const auto rect = mask(size);
+        return std::vector<float>{ float(rect.left()), float(rect.top()), float(rect.right()), float(rect.bottom()) };
+    };
+
+    return {
+        { "MaskingFilter", "OCLProjectionMaskingFilter",
+          [mask] (uint size) { return std::make_shared<MaskingFilter>(mask(size)); },
+          [mask] (uint size) { return std::make_shared<OCLProjectionMaskingFilter>(mask(size)); },
+          0.0f, 0.0 },
+        { "MaskingFilter", "GenericOCLProjectionFilter(projectionmaskingfilter.cl)",
+          [mask] (uint size) { return std::make_shared<MaskingFilter>(mask(size)); },
+          [clPath, maskArguments] (uint size) {
+              return std::make_shared<CTL::OCL::GenericOCLProjectionFilter>(
+                          OCLProgramCache::clFilePath(clPath + "projectionmaskingfilter.cl"), maskArguments(size)); },
+          0.0f, 0.0 },
+        { "MaskingFilter", "BatchedOCLProjectionFilter(projectionmaskingfilter_batch.cl)",
+          [mask] (uint size) { return std::make_shared<MaskingFilter>(mask(size)); },
+          [clPath, maskArguments] (uint size) {
+              return std::make_shared<BatchedOCLProjectionFilter>(clPath + "projectionmaskingfilter_batch.cl",
+                                                                  maskArguments(size)); },
+          0.0f, 0.0 },
+    };
+}
+
+CTL::VoxelVolume<float> randomVolume(uint size)
+{
+    CTL::VoxelVolume<float> ret(size, size, size, 1.0f, 1.0f, 1.0f);
+    ret.allocateMemory();
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    std::generate(ret.begin(), ret.end(), [&] { return distribution(rng); });
+
+    return ret;
+}
+
+CTL::ProjectionData randomProjections(uint size)
+{
+    CTL::ProjectionData ret(size, size, 1);
+    ret.allocateMemory(NB_VIEWS);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    std::generate(ret.begin(), ret.end(), [&] { return distribution(rng); });
+
+    return ret;
+}
+
+size_t nbElements(const CTL::VoxelVolume<float>& volume)
+{
+    return volume.totalVoxelCount();
+}
+
+size_t nbElements(const CTL::ProjectionData& projections)
+{
+    const auto dim = projections.dimensions();
+    return size_t(dim.nbChannels) * dim.nbRows * dim.nbModules * dim.nbViews;
+}
+
+// median time of filter.filter(copy of 'input'); the result of the last run ends up in 'result'
+template <class Filter, class Data>
+double timeFilter(Filter& filter, const Data& input, uint nbWarmup, uint nbRepetitions, Data& result)
+{
+    std::vector<double> seconds;
+    for(uint rep = 0; rep < nbWarmup + nbRepetitions; ++rep)
+    {
+        result = input; // not timed
+
+        const auto start = Clock::now();
+        filter.filter(result);
+        if(rep >= nbWarmup)
+            seconds.push_back(secondsSince(start));
+    }
+
+    return median(seconds);
+}
+
+// median time of uploading and downloading 'nbBytes' (blocking)
+double transferSeconds(size_t nbBytes, uint nbRepetitions)
+{
+    const auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    cl::CommandQueue queue(oclConfig.context(), oclConfig.devices().front());
+    cl::Buffer buffer(oclConfig.context(), CL_MEM_READ_WRITE, nbBytes);
+    std::vector<char> host(nbBytes);
+
+    std::vector<double> seconds;
+    for(uint rep = 0; rep <= nbRepetitions; ++rep) // first one: warm-up
+    {
+        const auto start = Clock::now();
+        queue.enqueueWriteBuffer(buffer, CL_TRUE, 0, nbBytes, host.data());
+        queue.enqueueReadBuffer(buffer, CL_TRUE, 0, nbBytes, host.data());
+        if(rep > 0)
+            seconds.push_back(secondsSince(start));
+    }
+
+    return median(seconds);
+}
+
+template <class Data>
+QJsonObject compare(const Data& cpuResult, const Data& oclResult, float tolerance, double maxMismatchFraction)
+{
+    double maxDiff = 0.0;
+    double sumSquaredDiff = 0.0;
+    size_t nbMismatches = 0;
+
+    auto ocl = oclResult.cbegin();
+    for(auto cpu = cpuResult.cbegin(); cpu != cpuResult.cend(); ++cpu, ++ocl)
+    {
+        const auto diff = std::fabs(double(*cpu) - double(*ocl));
+        maxDiff = std::max(maxDiff, diff);
+        sumSquaredDiff += diff * diff;
+        if(!(diff <= tolerance)) // incl. NaN
+            ++nbMismatches;
+    }
+
+    const auto n = double(nbElements(cpuResult));
+
+    QJsonObject ret;
+    ret.insert("max abs difference", maxDiff);
+    ret.insert("rmse", std::sqrt(sumSquaredDiff / n));
+    ret.insert("mismatches", static_cast<double>(nbMismatches));
+    ret.insert("tolerance", tolerance);
+    ret.insert("agree", nbMismatches <= maxMismatchFraction * n);
+    return ret;
+}
+
+template <class Filter, class Data>
+QJsonObject runPair(const FilterPair<Filter>& pair, uint size, const Data& input, uint nbWarmup, uint nbRepetitions)
+{
+    QJsonObject ret;
+    ret.insert("cpu filter", pair.cpuFilter);
+    ret.insert("ocl filter", pair.oclFilter);
+    ret.insert("size", static_cast<int>(size));
+    ret.insert("elements", static_cast<double>(nbElements(input)));
+
+    try {
+        const auto cpuFilter = pair.makeCpu(size);
+        const auto oclFilter = pair.makeOcl(size);
+
+        Data cpuResult = input;
+        Data oclResult = input;
+        const auto cpuSeconds = timeFilter(*cpuFilter, input, nbWarmup, nbRepetitions, cpuResult);
+        const auto oclSeconds = timeFilter(*oclFilter, input, nbWarmup, nbRepetitions, oclResult);
+        const auto transfer = transferSeconds(nbElements(input) * sizeof(float), nbRepetitions);
+
+        const auto bytes = 2.0 * sizeof(float) * nbElements(input);
+        ret.insert("cpu seconds", cpuSeconds);
+        ret.insert("cpu bytes per second", bytes / cpuSeconds);
+        ret.insert("ocl seconds", oclSeconds);
+        ret.insert("ocl bytes per second", bytes / oclSeconds);
+        ret.insert("transfer seconds", transfer);
+        ret.insert("compute seconds", std::max(oclSeconds - transfer, 0.0));
+        ret.insert("speedup", cpuSeconds / oclSeconds);
+
+        const auto comparison = compare(cpuResult, oclResult, pair.tolerance, pair.maxMismatchFraction);
+        for(auto it = comparison.constBegin(); it != comparison.constEnd(); ++it)
+            ret.insert(it.key(), it.value());
+
+    } catch (const std::bad_alloc&) {
+        ret.insert("error", "not enough memory");
+    } catch (const std::exception& err) {
+        ret.insert("error", err.what());
+    }
+
+    return ret;
+}
+
+} // unnamed namespace
+
+QJsonArray runFilterPairs(const std::vector<uint>& sizes, uint nbWarmup, uint nbRepetitions,
+                          const std::string& clPath)
+{
+    QJsonArray ret;
+
+    for(const auto size : sizes)
+    {
+        try {
+            const auto volume = randomVolume(size);
+            for(const auto& pair : volumePairs(clPath))
+                ret.append(runPair(pair, size, volume, nbWarmup, nbRepetitions));
+        } catch (const std::bad_alloc&) {
+            qWarning() << "Skipping volume size" << size << ": not enough memory.";
+        }
+
+        try {
+            const auto projections = randomProjections(size);
+            for(const auto& pair : projectionPairs(clPath))
+                ret.append(runPair(pair, size, projections, nbWarmup, nbRepetitions));
+        } catch (const std::bad_alloc&) {
+            qWarning() << "Skipping projection size" << size << ": not enough memory.";
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,21 @@
+#ifndef FILTERPAIRS_H
+#define FILTERPAIRS_H
+
+#include <QJsonArray>
+
+#include <string>
+#include <vector>
+
+// CPU/OpenCL filter pairs (e.g. MaskingFilter and projectionmaskingfilter.cl):
+// both filters of a pair are applied to the same random data of each size, the results are
+// compared element-wise and the throughput of both is reported
+// -> "transfer seconds" is the time for uploading and downloading the data once (measured
+//    separately), "compute seconds" is the remaining time of the OpenCL filter
+// -> "agree": at most 'max mismatch fraction' of the elements differ by more than 'tolerance'
+//    (threshold-based filters may differ for values exactly at a threshold)
+// -> "speedup" > 1: offloading to OpenCL pays off for this filter and size
+// 'clPath' is the folder of the tutorial's .cl files (empty: embedded kernels, see OCLProgramCache)
+QJsonArray runFilterPairs(const std::vector<uint>& sizes, uint nbWarmup, uint nbRepetitions,
+                          const std::string& clPath);
+
+#endif // FILTERPAIRS_H
@@ -0,0 +1,327 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include "ctl.h"
+#include "ctl_ocl.h"
+
+#include "compileddatamodel.h"
+#include "customoclvolumefilters.h"
+#include "customvolumefilters.h"
+#include "filterpairs.h"
+#include "oclprofiler.h"
+#include "oclprogramcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+ * Tutorial A2B - throughput benchmark of the custom volume filters
+ *
+ * usage: tutorialA2B_benchmark [--sizes 128,256,512,1024] [--warmup 1] [--repetitions 5] [--output file.json]
+ *                              [--pairs] [--trace trace.json]
+ * -> prints the results as JSON to stdout (and to the output file, if specified)
+ * -> --pairs: compares CPU filters with their OpenCL counterparts instead (see filterpairs.h)
+ * -> --trace: profiles the OpenCL commands of the tutorial's filters and writes them as a Chrome
+ *    trace (see oclprofiler.h); profiling adds some overhead to the timings
+ * -> "bytes per second" counts one read and one write of each voxel
+ * -> each filter and size runs in a child process (the executable itself with --run), such that
+ *    "peak rss bytes" is the peak memory usage of this run only (the peak of a process never
+ *    decreases); with --trace, each run writes its own trace file (<trace>_<filter index>_<size>.json)
+ */
+
+namespace {
+
+struct Benchmark
+{
+    QString filter;
+    QString device;
+    std::function<std::shared_ptr<CTL::AbstractVolumeFilter>()> makeFilter;
+};
+
+// folder with the tutorial's .cl files; empty: the kernels embedded from ../kernels.qrc
+const std::string CL_PATH = "";
+
+quint64 peakRss()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+  #if defined(Q_OS_MACOS)
+    return static_cast<quint64>(usage.ru_maxrss); // bytes
+  #else
+    return static_cast<quint64>(usage.ru_maxrss) * 1024; // kilobytes
+  #endif
+#endif
+}
+
+std::shared_ptr<CTL::AbstractDataModel> piecewiseConstantModel()
+{
+    std::vector<std::shared_ptr<CTL::RectFunctionModel>> steps;
+    steps.push_back(std::make_shared<CTL::RectFunctionModel>(0.0, 0.2, 0.0));
+    steps.push_back(std::make_shared<CTL::RectFunctionModel>(0.2, 0.9, 1.0));
+    steps.push_back(std::make_shared<CTL::RectFunctionModel>(0.9, 1.0, 2.0));
+
+    std::shared_ptr<CTL::AbstractDataModel> start = std::make_shared<CTL::ConstantModel>(0.0f);
+
+    return std::accumulate(steps.begin(), steps.end(), start);
+}
+
+std::vector<Benchmark> benchmarks()
+{
+    const auto model = piecewiseConstantModel();
+    const auto thresholds = std::vector<float>{ 0.2f, 0.9f, 1.0f };
+
+    return {
+        { "MovingAverageFilter(1)", "CPU", [] { return std::make_shared<MovingAverageFilter>(1); } },
+        { "MovingAverageFilter(5)", "CPU", [] { return std::make_shared<MovingAverageFilter>(5); } },
+        { "GaussianFilter(3.0)", "CPU", [] { return std::make_shared<GaussianFilter>(3.0f); } },
+        { "ModelApplicationFilter", "CPU", [model] { return std::make_shared<ModelApplicationFilter>(model); } },
+        { "ModelApplicationFilter(compiled)", "CPU", [model] {
+              return std::make_shared<ModelApplicationFilter>(std::make_shared<CompiledDataModel>(model, 0.0f, 1.0f)); } },
+        { "GenericOCLVolumeFilter(volumesegmentationfilter.cl)", "OpenCL", [thresholds] {
+              return std::make_shared<CTL::OCL::GenericOCLVolumeFilter>(
+                          OCLProgramCache::clFilePath(CL_PATH + "volumesegmentationfilter.cl"), thresholds); } },
+        { "PipelinedOCLVolumeFilter(volumesegmentationfilter.cl)", "OpenCL", [thresholds] {
+              return std::make_shared<PipelinedOCLVolumeFilter>(CL_PATH + "volumesegmentationfilter.cl", thresholds); } },
+        { "VolumeSegmentationFilter", "OpenCL", [] {
+              return std::make_shared<VolumeSegmentationFilter>(std::vector<float>{ 0.1f, 0.25f, 0.5f, 0.9f, 1.0f }); } },
+        { "VolumeSegmentationFilter(64 thresholds)", "OpenCL", [] {
+              std::vector<float> thresholds(64);
+              for(uint i = 0; i < thresholds.size(); ++i)
+                  thresholds[i] = (i + 1) / 64.0f;
+              return std::make_shared<VolumeSegmentationFilter>(std::move(thresholds)); } },
+        { "VolumeSegmentationFilter(multi device)", "OpenCL", [] {
+              auto filter = std::make_shared<VolumeSegmentationFilter>(std::vector<float>{ 0.1f, 0.25f, 0.5f, 0.9f, 1.0f });
+              filter->setMultiDevice(true);
+              return filter; } },
+        { "OCLMovingAverageFilter(1)", "OpenCL", [] { return std::make_shared<OCLMovingAverageFilter>(1); } },
+        { "OCLMovingAverageFilter(5)", "OpenCL", [] { return std::make_shared<OCLMovingAverageFilter>(5); } },
+    };
+}
+
+QJsonObject runBenchmark(CTL::AbstractVolumeFilter& filter, const CTL::VoxelVolume<float>& input,
+                         uint nbWarmup, uint nbRepetitions)
+{
+    std::vector<double> seconds;
+    for(uint rep = 0; rep < nbWarmup + nbRepetitions; ++rep)
+    {
+        auto volume = input; // not timed
+
+        const auto start = std::chrono::steady_clock::now();
+        filter.filter(volume);
+        const auto stop = std::chrono::steady_clock::now();
+
+        if(rep >= nbWarmup)
+            seconds.push_back(std::chrono::duration<double>(stop - start).count());
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+    const auto median = seconds[seconds.size() / 2];
+    const auto mean = std::accumulate(seconds.cbegin(), seconds.cend(), 0.0) / seconds.size();
+    const auto nbVoxels = static_cast<double>(input.totalVoxelCount());
+
+    QJsonObject ret;
+    ret.insert("seconds min", seconds.front());
+    ret.insert("seconds median", median);
+    ret.insert("seconds mean", mean);
+    ret.insert("voxels per second", nbVoxels / median);
+    ret.insert("bytes per second", 2.0 * sizeof(float) * nbVoxels / median);
+    return ret;
+}
+
+// a single benchmark (index into benchmarks()) with a single size; runs in a child process
+QJsonObject runSingle(uint index, uint size, uint nbWarmup, uint nbRepetitions)
+{
+    const auto allBenchmarks = benchmarks();
+    const auto& benchmark = allBenchmarks.at(index);
+
+    QJsonObject ret;
+    ret.insert("filter", benchmark.filter);
+    ret.insert("device", benchmark.device);
+    ret.insert("size", static_cast<int>(size));
+    ret.insert("voxels", static_cast<double>(size) * size * size);
+    ret.insert("warmup", static_cast<int>(nbWarmup));
+    ret.insert("repetitions", static_cast<int>(nbRepetitions));
+
+    try {
+        const auto filter = benchmark.makeFilter(); // compiles the OpenCL kernels (not timed)
+
+        CTL::VoxelVolume<float> input(size, size, size, 1.0f, 1.0f, 1.0f);
+        input.allocateMemory();
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+        std::generate(input.begin(), input.end(), [&] { return distribution(rng); });
+
+        const auto timing = runBenchmark(*filter, input, nbWarmup, nbRepetitions);
+        for(auto it = timing.constBegin(); it != timing.constEnd(); ++it)
+            ret.insert(it.key(), it.value());
+    } catch (const std::bad_alloc&) {
+        ret.insert("error", "not enough memory");
+    } catch (const std::exception& err) {
+        ret.insert("error", err.what());
+    }
+    ret.insert("peak rss bytes", static_cast<double>(peakRss()));
+
+    return ret;
+}
+
+// runs runSingle() in a child process and returns its result (passed through a temporary file,
+// stdout of the child may contain messages)
+QJsonObject runChild(uint index, uint size, uint nbWarmup, uint nbRepetitions, const QString& traceFile)
+{
+    QTemporaryFile resultFile;
+    if(!resultFile.open())
+        return { { "filter", benchmarks().at(index).filter }, { "error", "could not create a temporary file" } };
+    resultFile.close();
+
+    QStringList arguments{ "--run", QString::number(index), "--sizes", QString::number(size),
+                           "--warmup", QString::number(nbWarmup), "--repetitions", QString::number(nbRepetitions),
+                           "--output", resultFile.fileName() };
+    if(!traceFile.isEmpty())
+    {
+        const QFileInfo info(traceFile);
+        arguments << "--trace" << info.path() + "/" + info.completeBaseName()
+                                  + QString("_%1_%2.json").arg(index).arg(size);
+    }
+
+    QProcess child;
+    child.setProcessChannelMode(QProcess::ForwardedChannels);
+    child.start(QCoreApplication::applicationFilePath(), arguments);
+    child.waitForFinished(-1);
+
+    QJsonObject result;
+    if(resultFile.open())
+        result = QJsonDocument::fromJson(resultFile.readAll()).object();
+    if(child.exitStatus() == QProcess::NormalExit && !result.isEmpty())
+        return result;
+
+    QJsonObject ret;
+    ret.insert("filter", benchmarks().at(index).filter);
+    ret.insert("device", benchmarks().at(index).device);
+    ret.insert("size", static_cast<int>(size));
+    ret.insert("error", "benchmark process failed (exit code " + QString::number(child.exitCode()) + ")");
+    return ret;
+}
+
+// prints the report and writes it to 'fileName' (if not empty); returns the exit code
+int writeReport(const QJsonObject& report, const QString& fileName)
+{
+    const auto json = QJsonDocument(report).toJson();
+    std::cout << json.toStdString() << std::endl;
+
+    if(!fileName.isEmpty())
+    {
+        QFile file(fileName);
+        if(!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+        {
+            qCritical() << "Could not write" << fileName;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+} // unnamed namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    qInstallMessageHandler(CTL::MessageHandler::qInstaller);
+    CTL::MessageHandler::instance().blacklistMessageType(QtDebugMsg);
+    CTL::MessageHandler::instance().blacklistMessageType(QtInfoMsg);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({ "sizes", "Comma-separated edge lengths of the cubic volumes.", "sizes", "128,256,512,1024" });
+    parser.addOption({ "warmup", "Number of warm-up runs (not timed).", "n", "1" });
+    parser.addOption({ "repetitions", "Number of timed runs.", "n", "5" });
+    parser.addOption({ "output", "JSON output file.", "file" });
+    parser.addOption({ "pairs", "Compare CPU filters with their OpenCL counterparts (results and throughput)." });
+    parser.addOption({ "trace", "Chrome trace file of the profiled OpenCL commands.", "file" });
+    parser.addOption({ "run", "Internal: runs only the benchmark with this index for the first size and writes "
+                              "its result to the output file.", "index" });
+    parser.process(a);
+
+    std::vector<uint> sizes;
+    for(const auto& size : parser.value("sizes").split(',', Qt::SkipEmptyParts))
+        sizes.push_back(size.toUInt());
+    std::sort(sizes.begin(), sizes.end());
+    const auto nbWarmup = parser.value("warmup").toUInt();
+    const auto nbRepetitions = std::max(parser.value("repetitions").toUInt(), 1u);
+
+    // must be enabled before the filters create their command queues
+    if(parser.isSet("trace"))
+        OCLProfiler::instance().setEnabled(true);
+
+    if(parser.isSet("run"))
+    {
+        if(sizes.empty())
+            return 1;
+        const auto result = runSingle(parser.value("run").toUInt(), sizes.front(), nbWarmup, nbRepetitions);
+        if(parser.isSet("trace"))
+            OCLProfiler::instance().writeChromeTrace(parser.value("trace"));
+
+        QFile file(parser.value("output"));
+        const auto json = QJsonDocument(result).toJson(QJsonDocument::Compact);
+        return file.open(QIODevice::WriteOnly) && file.write(json) == json.size() ? 0 : 1;
+    }
+
+    QJsonObject system;
+    system.insert("threads", QThread::idealThreadCount());
+    system.insert("opencl", CTL::OCL::OpenCLConfig::instance().isValid());
+
+    if(parser.isSet("pairs"))
+    {
+        QJsonObject report;
+        report.insert("benchmark", "tutorialA2B CPU/OpenCL filter pairs");
+        report.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+        report.insert("system", system);
+        report.insert("results", runFilterPairs(sizes, nbWarmup, nbRepetitions, CL_PATH));
+        if(parser.isSet("trace"))
+            OCLProfiler::instance().writeChromeTrace(parser.value("trace"));
+        return writeReport(report, parser.value("output"));
+    }
+
+    // one child process per filter and size (see above)
+    const auto nbBenchmarks = static_cast<uint>(benchmarks().size());
+    QJsonArray results;
+    for(const auto size : sizes)
+        for(uint index = 0; index < nbBenchmarks; ++index)
+            results.append(runChild(index, size, nbWarmup, nbRepetitions, parser.value("trace")));
+
+    QJsonObject report;
+    report.insert("benchmark", "tutorialA2B volume filters");
+    report.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert("system", system);
+    report.insert("results", results);
+
+    return writeReport(report, parser.value("output"));
+}
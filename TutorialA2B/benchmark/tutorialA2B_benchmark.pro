@@ -0,0 +1,47 @@
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+SOURCES += \
+        filterpairs.cpp \
+        main.cpp \
+        ../batchdatamodel.cpp \
+        ../compileddatamodel.cpp \
+        ../customoclprojectionfilters.cpp \
+        ../customoclvolumefilters.cpp \
+        ../customvolumefilters.cpp \
+        ../deviceprojectiondata.cpp \
+        ../oclprofiler.cpp \
+        ../oclprogramcache.cpp \
+        ../workgrouptuner.cpp \
+        ../../TutorialA2/abstractviewfilter.cpp \
+        ../../TutorialA2/customprojectionfilters.cpp \
+        ../../TutorialA2/roiprojectiondata.cpp \
+        ../../TutorialA2/threadpool.cpp
+
+HEADERS += \
+    filterpairs.h \
+    ../batchdatamodel.h \
+    ../compileddatamodel.h \
+    ../customoclprojectionfilters.h \
+    ../customoclvolumefilters.h \
+    ../customvolumefilters.h \
+    ../deviceprojectiondata.h \
+    ../oclprofiler.h \
+    ../oclprogramcache.h \
+    ../workgrouptuner.h \
+    ../../TutorialA2/abstractviewfilter.h \
+    ../../TutorialA2/customprojectionfilters.h \
+    ../../TutorialA2/roiprojectiondata.h \
+    ../../TutorialA2/threadpool.h \
+    ../../TutorialA3/halfprecision.h
+
+RESOURCES += ../kernels.qrc
+
+# CPU projection filters from Tutorial A2, 16 bit types from Tutorial A3
+INCLUDEPATH += .. ../../TutorialA2 ../../TutorialA3
+
+include(../../../ctl/modules/ctl.pri)
+include(../../../ctl/modules/ctl_ocl.pri)
+
+# peak memory usage (GetProcessMemoryInfo)
+win32: LIBS += -lpsapi
@@ -0,0 +1,382 @@
+#include "customoclprojectionfilters.h"
+#include "halfprecision.h"
+#include "oclprofiler.h"
+#include "oclprogramcache.h"
+#include "workgrouptuner.h"
+
+#include "processing/genericoclprojectionfilter.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
+
+DECLARE_SERIALIZABLE_TYPE(OCLProjectionMaskingFilter)
+DECLARE_SERIALIZABLE_TYPE(BatchedOCLProjectionFilter)
+
+namespace {
+
+const std::string MASKING_CL_FILE = "projectionmaskingfilter_device.cl"; // embedded (see kernels.qrc)
+const std::string MASKING_PROGRAM = "OCLProjectionMaskingFilter";
+const std::string MASKING_KERNEL = "mask_rect";
+const std::string BATCH_KERNEL = "filter_batch";
+const std::string HALF_KERNEL = "filter_batch_half";
+
+// one program per .cl file
+std::string batchProgram(const std::string& clFileName)
+{
+    return "BatchedOCLProjectionFilter:" + clFileName;
+}
+
+} // unnamed namespace
+
+AbstractOCLProjectionFilter::AbstractOCLProjectionFilter()
+{
+    auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    if(!oclConfig.isValid())
+        throw std::runtime_error("AbstractOCLProjectionFilter: OpenCLConfig is not valid.");
+
+    m_queue = OCLProfiler::instance().createQueue(oclConfig.context(), oclConfig.devices().front());
+}
+
+void AbstractOCLProjectionFilter::filter(CTL::ProjectionData& projections)
+{
+    try {
+
+        DeviceProjectionData deviceProjections(projections, m_queue);
+        filter(deviceProjections);
+        deviceProjections.copyTo(projections);
+
+    }  catch (const cl::Error& err) {
+        qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
+    }
+}
+
+OCLProjectionMaskingFilter::OCLProjectionMaskingFilter(const QRect& mask)
+    : OCLProjectionMaskingFilter()
+{
+    m_border = mask;
+}
+
+OCLProjectionMaskingFilter::OCLProjectionMaskingFilter()
+{
+    OCLProgramCache::instance().addKernel(MASKING_KERNEL, OCLProgramCache::loadSourceCode(MASKING_CL_FILE),
+                                          MASKING_PROGRAM);
+}
+
+void OCLProjectionMaskingFilter::filter(DeviceProjectionData& projections)
+{
+    const auto& dims = projections.dimensions();
+
+    auto kernel = OCLProgramCache::instance().kernel(MASKING_KERNEL, MASKING_PROGRAM);
+    kernel.setArg(0, projections.deviceBuffer());
+    kernel.setArg(1, m_border.left());
+    kernel.setArg(2, m_border.top());
+    kernel.setArg(3, m_border.right());
+    kernel.setArg(4, m_border.bottom());
+
+    // no synchronization: subsequent commands on the (in-order) queue see the result
+    // (tuned in 2D like the batched kernel; masking in place is idempotent)
+    auto& queue = projections.queue();
+    const cl::NDRange globalSize(dims.nbChannels, dims.nbRows, size_t(dims.nbModules) * dims.nbViews);
+    const auto localSize = WorkGroupTuner::instance().localSize(
+                MASKING_PROGRAM + ":" + MASKING_KERNEL, kernel, queue, globalSize,
+                [&] (const cl::NDRange& local) { queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, local); },
+                2);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize);
+}
+
+QVariant OCLProjectionMaskingFilter::parameter() const
+{
+    auto parMap = CTL::AbstractProjectionFilter::parameter().toMap();
+
+    QVariantList list{ m_border.x(), m_border.y(), m_border.width(), m_border.height() };
+    parMap.insert("mask border", list);
+
+    return parMap;
+}
+
+void OCLProjectionMaskingFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractProjectionFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+    if(parMap.contains("mask border"))
+    {
+        auto rectValues = parMap.value("mask border").toList();
+        m_border = QRect(rectValues.at(0).toInt(), rectValues.at(1).toInt(),
+                         rectValues.at(2).toInt(), rectValues.at(3).toInt());
+    }
+}
+
+BatchedOCLProjectionFilter::BatchedOCLProjectionFilter(const std::string& clFileName, std::vector<float> arguments)
+    : m_clFileName(clFileName)
+    , m_arguments(std::move(arguments))
+{
+    loadKernel();
+}
+
+BatchedOCLProjectionFilter::BatchedOCLProjectionFilter() = default;
+
+BatchedOCLProjectionFilter::~BatchedOCLProjectionFilter() = default;
+
+void BatchedOCLProjectionFilter::filter(CTL::ProjectionData& projections)
+{
+    if(m_perViewFilter)
+    {
+        m_perViewFilter->filter(projections);
+        return;
+    }
+
+    try {
+
+        if(m_halfTransfer && m_hasHalfKernel)
+        {
+            filterHalfPrecision(projections);
+            return;
+        }
+        if(m_halfTransfer)
+            qWarning() << "BatchedOCLProjectionFilter:" << QString::fromStdString(m_clFileName)
+                       << "has no kernel" << QString::fromStdString(HALF_KERNEL) << "- using float transfers.";
+
+        const auto dims = projections.dimensions();
+        const auto moduleBytes = size_t(dims.nbChannels) * dims.nbRows * sizeof(float);
+        const auto blockViews = viewsPerBlock(dims, m_queue);
+        const auto blockBytes = size_t(blockViews) * dims.nbModules * moduleBytes;
+
+        const auto context = m_queue.getInfo<CL_QUEUE_CONTEXT>();
+        cl::Buffer input(context, CL_MEM_READ_ONLY, blockBytes);
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, blockBytes);
+
+        // per block: upload, single launch, download
+        for(uint firstView = 0; firstView < dims.nbViews; firstView += blockViews)
+        {
+            const auto nbViews = std::min(blockViews, dims.nbViews - firstView);
+
+            size_t offset = 0;
+            for(uint view = firstView; view < firstView + nbViews; ++view)
+                for(const auto& module : projections.view(view).data())
+                {
+                    m_queue.enqueueWriteBuffer(input, CL_FALSE, offset, moduleBytes, module.rawData());
+                    offset += moduleBytes;
+                }
+
+            filterBlock(BATCH_KERNEL, m_queue, input, output, dims, firstView, nbViews);
+
+            offset = 0;
+            for(uint view = firstView; view < firstView + nbViews; ++view)
+                for(auto& module : projections.view(view).data())
+                {
+                    m_queue.enqueueReadBuffer(output, CL_FALSE, offset, moduleBytes, module.rawData());
+                    offset += moduleBytes;
+                }
+            m_queue.finish();
+        }
+
+    }  catch (const cl::Error& err) {
+        qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
+    }
+}
+
+void BatchedOCLProjectionFilter::filter(DeviceProjectionData& projections)
+{
+    if(m_perViewFilter)
+    {
+        // per-view kernels work on host data only (downloads the projections)
+        m_perViewFilter->filter(projections.hostData());
+        return;
+    }
+
+    const auto& dims = projections.dimensions();
+    const auto& queue = projections.queue();
+    const auto viewBytes = size_t(dims.nbChannels) * dims.nbRows * dims.nbModules * sizeof(float);
+    const auto blockViews = viewsPerBlock(dims, queue);
+
+    const auto context = queue.getInfo<CL_QUEUE_CONTEXT>();
+    cl::Buffer input(context, CL_MEM_READ_ONLY, blockViews * viewBytes);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, blockViews * viewBytes);
+
+    // blocks are copied on the device only (no host transfers)
+    auto& buffer = projections.deviceBuffer();
+    for(uint firstView = 0; firstView < dims.nbViews; firstView += blockViews)
+    {
+        const auto nbViews = std::min(blockViews, dims.nbViews - firstView);
+        const auto offset = firstView * viewBytes;
+
+        queue.enqueueCopyBuffer(buffer, input, offset, 0, nbViews * viewBytes);
+        filterBlock(BATCH_KERNEL, queue, input, output, dims, firstView, nbViews);
+        queue.enqueueCopyBuffer(output, buffer, 0, offset, nbViews * viewBytes);
+    }
+}
+
+bool BatchedOCLProjectionFilter::isBatched() const
+{
+    return !m_perViewFilter;
+}
+
+uint BatchedOCLProjectionFilter::maxViewsPerBlock() const
+{
+    return m_maxViewsPerBlock;
+}
+
+void BatchedOCLProjectionFilter::setMaxViewsPerBlock(uint maxViews)
+{
+    m_maxViewsPerBlock = maxViews;
+}
+
+bool BatchedOCLProjectionFilter::halfPrecisionTransfer() const
+{
+    return m_halfTransfer;
+}
+
+void BatchedOCLProjectionFilter::setHalfPrecisionTransfer(bool enabled)
+{
+    m_halfTransfer = enabled;
+}
+
+QVariant BatchedOCLProjectionFilter::parameter() const
+{
+    auto parMap = CTL::AbstractProjectionFilter::parameter().toMap();
+
+    parMap.insert("cl file name", QString::fromStdString(m_clFileName));
+    parMap.insert("arguments", QVariantList(m_arguments.cbegin(), m_arguments.cend())); // Note: requires Qt >= 5.14
+    parMap.insert("max views per block", m_maxViewsPerBlock);
+    parMap.insert("half precision transfer", m_halfTransfer);
+
+    return parMap;
+}
+
+void BatchedOCLProjectionFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractProjectionFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("cl file name"))
+        m_clFileName = parMap.value("cl file name").toString().toStdString();
+    if(parMap.contains("arguments"))
+    {
+        const auto arguments = parMap.value("arguments").toList();
+        m_arguments.resize(arguments.size());
+        std::transform(arguments.cbegin(), arguments.cend(), m_arguments.begin(),
+                       [] (const QVariant& value) { return value.toFloat(); });
+    }
+    if(parMap.contains("max views per block"))
+        m_maxViewsPerBlock = parMap.value("max views per block").toUInt();
+    if(parMap.contains("half precision transfer"))
+        m_halfTransfer = parMap.value("half precision transfer").toBool();
+
+    if((parMap.contains("cl file name") || parMap.contains("arguments")) && !m_clFileName.empty())
+        loadKernel();
+}
+
+// uses the batched kernel if the .cl file provides one, otherwise falls back to the per-view
+// application by GenericOCLProjectionFilter
+void BatchedOCLProjectionFilter::loadKernel()
+{
+    const auto clSourceCode = OCLProgramCache::loadSourceCode(m_clFileName);
+
+    const auto hasKernel = [&clSourceCode] (const std::string& kernelName) {
+        return std::regex_search(clSourceCode, std::regex("kernel\\s+void\\s+" + kernelName + "\\b"));
+    };
+
+    m_hasHalfKernel = false;
+    if(!hasKernel(BATCH_KERNEL))
+    {
+        m_perViewFilter.reset(new CTL::OCL::GenericOCLProjectionFilter(OCLProgramCache::clFilePath(m_clFileName),
+                                                                       m_arguments));
+        return;
+    }
+
+    m_perViewFilter.reset();
+    OCLProgramCache::instance().addKernel(BATCH_KERNEL, clSourceCode, batchProgram(m_clFileName));
+    if(hasKernel(HALF_KERNEL))
+    {
+        OCLProgramCache::instance().addKernel(HALF_KERNEL, clSourceCode, batchProgram(m_clFileName));
+        m_hasHalfKernel = true;
+    }
+}
+
+// same as the float path of filter(), but the blocks are converted to Half on the host and
+// transferred in half precision (half of the PCIe traffic)
+void BatchedOCLProjectionFilter::filterHalfPrecision(CTL::ProjectionData& projections)
+{
+    const auto dims = projections.dimensions();
+    const auto moduleSize = size_t(dims.nbChannels) * dims.nbRows;
+    const auto blockViews = viewsPerBlock(dims, m_queue);
+    const auto blockSize = size_t(blockViews) * dims.nbModules * moduleSize;
+
+    const auto context = m_queue.getInfo<CL_QUEUE_CONTEXT>();
+    cl::Buffer input(context, CL_MEM_READ_ONLY, blockSize * sizeof(Half));
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, blockSize * sizeof(Half));
+    std::vector<Half> staging(blockSize);
+
+    for(uint firstView = 0; firstView < dims.nbViews; firstView += blockViews)
+    {
+        const auto nbViews = std::min(blockViews, dims.nbViews - firstView);
+        const auto nbBytes = size_t(nbViews) * dims.nbModules * moduleSize * sizeof(Half);
+
+        auto halfData = staging.data();
+        for(uint view = firstView; view < firstView + nbViews; ++view)
+            for(const auto& module : projections.view(view).data())
+            {
+                toHalfPrecision(module.rawData(), halfData, moduleSize);
+                halfData += moduleSize;
+            }
+
+        // the (blocking) read is enqueued after the write, i.e. 'staging' is not overwritten early
+        m_queue.enqueueWriteBuffer(input, CL_FALSE, 0, nbBytes, staging.data());
+        filterBlock(HALF_KERNEL, m_queue, input, output, dims, firstView, nbViews);
+        m_queue.enqueueReadBuffer(output, CL_TRUE, 0, nbBytes, staging.data());
+
+        halfData = staging.data();
+        for(uint view = firstView; view < firstView + nbViews; ++view)
+            for(auto& module : projections.view(view).data())
+            {
+                toSinglePrecision(halfData, module.rawData(), moduleSize);
+                halfData += moduleSize;
+            }
+    }
+}
+
+// 'input' -> 'output' for the views [firstView, firstView + nbViews) (kernel convention, see header)
+void BatchedOCLProjectionFilter::filterBlock(const std::string& kernelName, const cl::CommandQueue& queue,
+                                             const cl::Buffer& input, cl::Buffer& output,
+                                             const CTL::ProjectionData::Dimensions& dims, uint firstView,
+                                             uint nbViews) const
+{
+    auto kernel = OCLProgramCache::instance().kernel(kernelName, batchProgram(m_clFileName));
+    kernel.setArg(0, input);
+    kernel.setArg(1, output);
+    kernel.setArg(2, firstView);
+    kernel.setArg(3, dims.nbModules);
+    for(uint arg = 0; arg < m_arguments.size(); ++arg)
+        kernel.setArg(4 + arg, m_arguments[arg]);
+
+    // the number of views varies between blocks -> tuned in 2D (channels x rows) on the modules of one view
+    const cl::NDRange globalSize(dims.nbChannels, dims.nbRows, size_t(dims.nbModules) * nbViews);
+    const cl::NDRange tuningSize(dims.nbChannels, dims.nbRows, dims.nbModules);
+    const auto localSize = WorkGroupTuner::instance().localSize(
+                batchProgram(m_clFileName) + ":" + kernelName, kernel, queue, tuningSize,
+                [&] (const cl::NDRange& local) { queue.enqueueNDRangeKernel(kernel, cl::NullRange, tuningSize, local); },
+                2);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize, nullptr,
+                               OCLProfiler::instance().event(QString::fromStdString("BatchedOCLProjectionFilter " + kernelName)));
+}
+
+// input and output buffer of a block take up at most half of the device memory
+uint BatchedOCLProjectionFilter::viewsPerBlock(const CTL::ProjectionData::Dimensions& dims,
+                                               const cl::CommandQueue& queue) const
+{
+    const auto device = queue.getInfo<CL_QUEUE_DEVICE>();
+    const auto viewBytes = cl_ulong(dims.nbChannels) * dims.nbRows * dims.nbModules * sizeof(float);
+    const auto maxBytes = std::min(device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>(),
+                                   device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / 4);
+
+    auto ret = static_cast<uint>(std::min<cl_ulong>(maxBytes / viewBytes, dims.nbViews));
+    if(m_maxViewsPerBlock > 0)
+        ret = std::min(ret, m_maxViewsPerBlock);
+
+    return std::max(ret, 1u);
+}
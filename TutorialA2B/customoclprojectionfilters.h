@@ -0,0 +1,114 @@
+#ifndef CUSTOMOCLPROJECTIONFILTERS_H
+#define CUSTOMOCLPROJECTIONFILTERS_H
+
+#include "deviceprojectiondata.h"
+
+#include "processing/abstractprojectionfilter.h"
+
+#include <QRect>
+
+#include <memory>
+
+namespace CTL {
+namespace OCL {
+class GenericOCLProjectionFilter;
+}
+}
+
+// AbstractOCLProjectionFilter
+// projection filter that operates on device-resident projections (see DeviceProjectionData):
+// -> filter(DeviceProjectionData&) leaves the result on the device, such that several OpenCL
+//    filters can be applied in a row without transfers to the host in between
+// -> filter(ProjectionData&) uploads the projections, filters them and downloads the result
+class AbstractOCLProjectionFilter : public CTL::AbstractProjectionFilter
+{
+public:
+    virtual void filter(DeviceProjectionData& projections) = 0;
+
+    // AbstractProjectionFilter interface
+    void filter(CTL::ProjectionData& projections) override;
+
+protected:
+    AbstractOCLProjectionFilter();
+
+    cl::CommandQueue m_queue;
+};
+
+// OCLProjectionMaskingFilter
+// OpenCL version of MaskingFilter (rectangular mask) working on device-resident projections;
+// all modules of all views are processed by a single kernel launch
+class OCLProjectionMaskingFilter : public AbstractOCLProjectionFilter
+{
+    CTL_TYPE_ID(CTL::AbstractProjectionFilter::UserType + 4)
+
+public:
+    explicit OCLProjectionMaskingFilter(const QRect& mask);
+
+    using AbstractOCLProjectionFilter::filter;
+    void filter(DeviceProjectionData& projections) override;
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    OCLProjectionMaskingFilter();
+
+    QRect m_border;
+};
+
+// BatchedOCLProjectionFilter
+// applies an OpenCL projection filter kernel to blocks of views with a single launch per block
+// (instead of one launch per view as in GenericOCLProjectionFilter); batched kernel convention:
+//   kernel void filter_batch(global const float* oldProj, global float* newProj,
+//                            uint firstView, uint nbModules, float arg0, float arg1, ...)
+// -> 'oldProj'/'newProj' hold all modules of the block's views, one after another
+// -> the NDRange is (nbChannels, nbRows, nbModules * nbViewsInBlock), i.e. global id 2 is the
+//    module index within the block; the view of a work item is firstView + id2 / nbModules
+// -> the block size is chosen such that input and output of a block fit into device memory
+//    (or limited by setMaxViewsPerBlock())
+// .cl files without a 'filter_batch' kernel (i.e. per-view kernels named 'filter', see
+// GenericOCLProjectionFilter) are applied view by view as before
+// optionally, the host data can be transferred in half precision (see setHalfPrecisionTransfer()),
+// which requires a kernel 'filter_batch_half' with the same arguments, but 'half' buffers
+// (accessed by vload_half/vstore_half, arithmetic in float)
+class BatchedOCLProjectionFilter : public AbstractOCLProjectionFilter
+{
+    CTL_TYPE_ID(CTL::AbstractProjectionFilter::UserType + 5)
+
+public:
+    explicit BatchedOCLProjectionFilter(const std::string& clFileName, std::vector<float> arguments = {});
+    ~BatchedOCLProjectionFilter() override;
+
+    void filter(CTL::ProjectionData& projections) override;
+    void filter(DeviceProjectionData& projections) override;
+
+    bool isBatched() const;
+    uint maxViewsPerBlock() const;
+    void setMaxViewsPerBlock(uint maxViews); // 0: determined by the device memory
+    bool halfPrecisionTransfer() const;
+    void setHalfPrecisionTransfer(bool enabled);
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    BatchedOCLProjectionFilter();
+
+    void loadKernel();
+    void filterHalfPrecision(CTL::ProjectionData& projections);
+    void filterBlock(const std::string& kernelName, const cl::CommandQueue& queue, const cl::Buffer& input,
+                     cl::Buffer& output, const CTL::ProjectionData::Dimensions& dims, uint firstView,
+                     uint nbViews) const;
+    uint viewsPerBlock(const CTL::ProjectionData::Dimensions& dims, const cl::CommandQueue& queue) const;
+
+    std::string m_clFileName;
+    std::vector<float> m_arguments;
+    uint m_maxViewsPerBlock = 0;
+    bool m_halfTransfer = false;
+    bool m_hasHalfKernel = false;
+    std::unique_ptr<CTL::OCL::GenericOCLProjectionFilter> m_perViewFilter; // if not batched
+};
+
+#endif // CUSTOMOCLPROJECTIONFILTERS_H
@@ -1,31 +1,201 @@
 #include "customoclvolumefilters.h"
+#include "oclprofiler.h"
+#include "oclprogramcache.h"
+#include "workgrouptuner.h"
+
+#include "ocl/openclconfig.h"
 
 #include <QDebug>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
 DECLARE_SERIALIZABLE_TYPE(VolumeSegmentationFilter)
+DECLARE_SERIALIZABLE_TYPE(OCLMovingAverageFilter)
+DECLARE_SERIALIZABLE_TYPE(MultiDeviceOCLVolumeFilter)
+DECLARE_SERIALIZABLE_TYPE(PipelinedOCLVolumeFilter)
+
+namespace {
+
+// embedded kernel sources (see kernels.qrc)
+const std::string SEGMENTATION_CL_FILE = "volumesegementationfilter_flexible.cl";
+const std::string PLACEHOLDER_CL_FILE = "placeholdervolumefilter.cl";
+const std::string MOVING_AVERAGE_CL_FILE = "movingaveragefilter.cl";
+const std::string MOVING_AVERAGE_PROGRAM = "OCLMovingAverageFilter";
+const std::string TILED_KERNEL = "moving_average_tiled";
+const std::string LINES_KERNEL = "moving_average_lines";
+const std::string HALF_TO_FLOAT_KERNEL = "half_to_float";
+const std::string FLOAT_TO_HALF_KERNEL = "float_to_half";
+
+// preferred tile (= work-group) size
+const uint TILE_X = 8;
+const uint TILE_Y = 8;
+const uint TILE_Z = 4;
+
+const std::string MULTI_DEVICE_KERNEL = "filter";
+const std::string SEGMENTATION_KERNEL = "filter";
+const std::string PIPELINED_KERNEL = "filter";
+const uint NB_PIPELINE_STAGES = 2;
+
+// helper of the GenericOCLVolumeFilter kernel convention (provided by the CTL if it compiles the kernel)
+const std::string WRITE_BUFFER_HELPER = R"(
+void write_bufferf(global float* buffer, int4 coord, float value, image3d_t image)
+{
+    buffer[coord.x + get_image_width(image) * (coord.y + get_image_height(image) * (size_t)coord.z)] = value;
+}
+)";
+
+// program of a GenericOCLVolumeFilter kernel (built once for the single- and multi-device filters)
+std::string volumeFilterProgramName(const std::string& clFileName)
+{
+    return "MultiDeviceOCLVolumeFilter:" + clFileName;
+}
+
+// builds the program (or loads the cached binary) of a GenericOCLVolumeFilter kernel
+cl::Program volumeFilterProgram(const std::string& clFileName, const std::string& kernelName)
+{
+    auto& programs = OCLProgramCache::instance();
+    programs.addKernel(kernelName, WRITE_BUFFER_HELPER + OCLProgramCache::loadSourceCode(clFileName),
+                       volumeFilterProgramName(clFileName));
+    return programs.program(volumeFilterProgramName(clFileName));
+}
+
+// replaces the queue created by GenericOCLVolumeFilter (needs CL_QUEUE_PROFILING_ENABLE for the OCLProfiler)
+cl::CommandQueue profiledQueue(const cl::CommandQueue& queue)
+{
+    return OCLProfiler::instance().createQueue(queue.getInfo<CL_QUEUE_CONTEXT>(), queue.getInfo<CL_QUEUE_DEVICE>());
+}
 
+// runs 'task(device)' for all devices concurrently; rethrows the first exception
+void onAllDevices(size_t nbDevices, const std::function<void(size_t)>& task)
+{
+    std::vector<std::future<void>> done;
+    for(size_t dev = 0; dev < nbDevices; ++dev)
+        done.push_back(std::async(std::launch::async, task, dev));
+    for(auto& result : done)
+        result.get();
+}
+
+// host-side conversion between the volume data and the transferred type (float or Half)
+void convertPrecision(const float* src, Half* dst, size_t n) { toHalfPrecision(src, dst, n); }
+void convertPrecision(const Half* src, float* dst, size_t n) { toSinglePrecision(src, dst, n); }
+template<typename T>
+void convertPrecision(const T* src, T* dst, size_t n) { std::copy_n(src, n, dst); }
+
+// VolumeSegmentationFilter's kernel on all devices, using the owner's threshold buffer
+class MultiDeviceSegmentation : public MultiDeviceOCLVolumeFilter
+{
+public:
+    MultiDeviceSegmentation() : MultiDeviceOCLVolumeFilter(SEGMENTATION_CL_FILE) {}
+
+    void setThresholds(const cl::Buffer& buffer, uint nbThresholds, bool sorted)
+    {
+        m_buffer = buffer;
+        m_nbThresholds = nbThresholds;
+        m_sorted = sorted;
+    }
+
+protected:
+    void setAdditionalArguments(cl::Kernel& kernel) const override
+    {
+        kernel.setArg(3, m_buffer);
+        kernel.setArg(4, m_nbThresholds);
+        kernel.setArg(5, static_cast<uint>(m_sorted));
+    }
+
+private:
+    cl::Buffer m_buffer;
+    uint m_nbThresholds = 0;
+    bool m_sorted = false;
+};
+
+} // unnamed namespace
+
+// the base class only builds the placeholder kernel; the segmentation kernel is an own kernel object
+// of the (cached) program shared with MultiDeviceSegmentation
 VolumeSegmentationFilter::VolumeSegmentationFilter(std::vector<float> thresholds)
-    : CTL::OCL::GenericOCLVolumeFilter("F:/projects/ctl-tutorials/tutorialA2B/volumesegementationfilter_flexible.cl")
+    : CTL::OCL::GenericOCLVolumeFilter(OCLProgramCache::clFilePath(PLACEHOLDER_CL_FILE))
     , m_thresholds(std::move(thresholds))
+    , m_kernel(volumeFilterProgram(SEGMENTATION_CL_FILE, SEGMENTATION_KERNEL), SEGMENTATION_KERNEL.c_str())
 {
+    _queue = profiledQueue(_queue);
 }
 
 void VolumeSegmentationFilter::filter(CTL::VoxelVolume<float> &volume)
 {
     try {
 
-        const auto numThreholds = m_thresholds.size();
-        const auto bufferSize = sizeof(float) * numThreholds;
+        // markers around all commands of the call (recorded as a span)
+        auto& profiler = OCLProfiler::instance();
+        cl::Event callBegin;
+        if(profiler.isEnabled() && !m_multiDeviceFilter) // multi-device: profiled by MultiDeviceOCLVolumeFilter
+            _queue.enqueueMarkerWithWaitList(nullptr, &callBegin);
 
-        // create a buffer on the GPU and write in the thresholds
+        if(!m_thresholdsUploaded)
+            uploadThresholds();
+
+        const auto sorted = std::is_sorted(m_thresholds.cbegin(), m_thresholds.cend());
+
+        if(m_multiDeviceFilter)
+        {
+            _queue.finish(); // thresholds are used by the other devices' queues
+            auto& multiDevice = static_cast<MultiDeviceSegmentation&>(*m_multiDeviceFilter);
+            multiDevice.setThresholds(m_thresholdBuffer, static_cast<uint>(m_thresholds.size()), sorted);
+            multiDevice.filter(volume);
+            return;
+        }
+
+        // same as GenericOCLVolumeFilter::filter(), but with the cached kernel
+        const auto& dim = volume.dimensions();
         const auto& context = _queue.getInfo<CL_QUEUE_CONTEXT>();
-        auto thresholdBuffer = cl::Buffer(context, CL_MEM_READ_ONLY, bufferSize);
-        _queue.enqueueWriteBuffer(thresholdBuffer, CL_FALSE, 0, bufferSize, m_thresholds.data());
-        _kernel->setArg(3, thresholdBuffer);
-        _kernel->setArg(4, static_cast<uint>(numThreholds));
+        const auto nbBytes = volume.totalVoxelCount() * sizeof(float);
+
+        cl::Image3D input(context, CL_MEM_READ_ONLY, cl::ImageFormat(CL_R, CL_FLOAT), dim.x, dim.y, dim.z);
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, nbBytes);
 
-        // executing the "regular" filter routine
-        GenericOCLVolumeFilter::filter(volume);
+        cl::size_t<3> origin, region;
+        region[0] = dim.x;
+        region[1] = dim.y;
+        region[2] = dim.z;
+        _queue.enqueueWriteImage(input, CL_FALSE, origin, region, 0, 0, volume.rawData(), nullptr,
+                                 profiler.event("VolumeSegmentationFilter upload"));
+
+        m_kernel.setArg(0, input);
+        m_kernel.setArg(1, output);
+        m_kernel.setArg(3, m_thresholdBuffer);
+        m_kernel.setArg(4, static_cast<uint>(m_thresholds.size()));
+        m_kernel.setArg(5, static_cast<uint>(sorted));
+
+        m_kernel.setArg(2, 0u);
+
+        const cl::NDRange globalSize(dim.x, dim.y);
+        const auto localSize = WorkGroupTuner::instance().localSize(
+                    volumeFilterProgramName(SEGMENTATION_CL_FILE), m_kernel, _queue, globalSize,
+                    [&] (const cl::NDRange& local) {
+                        _queue.enqueueNDRangeKernel(m_kernel, cl::NullRange, globalSize, local); });
+
+        for(uint z = 0; z < dim.z; ++z)
+        {
+            m_kernel.setArg(2, z);
+            _queue.enqueueNDRangeKernel(m_kernel, cl::NullRange, globalSize, localSize, nullptr,
+                                        profiler.event("VolumeSegmentationFilter kernel"));
+        }
+
+        _queue.enqueueReadBuffer(output, CL_TRUE, 0, nbBytes, volume.rawData(), nullptr,
+                                 profiler.event("VolumeSegmentationFilter download"));
+
+        if(callBegin() != nullptr)
+        {
+            cl::Event callEnd;
+            _queue.enqueueMarkerWithWaitList(nullptr, &callEnd);
+            profiler.recordSpan(callBegin, callEnd, "VolumeSegmentationFilter call");
+        }
 
     }  catch (const cl::Error& err) {
         qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
@@ -37,6 +207,7 @@ QVariant VolumeSegmentationFilter::parameter() const
     auto parMap = GenericOCLVolumeFilter::parameter().toMap();
 
     parMap.insert("thresholds", QVariantList(m_thresholds.cbegin(), m_thresholds.cend())); // Note: requires Qt >= 5.14
+    parMap.insert("multi device", isMultiDevice());
 
     return parMap;
 }
@@ -53,12 +224,760 @@ void VolumeSegmentationFilter::setParameter(const QVariant &parameter)
         m_thresholds.resize(thresholds.size());
         std::transform(thresholds.cbegin(), thresholds.cend(), m_thresholds.begin(),
                        [] (const QVariant& value) { return value.toFloat(); });
+        m_thresholdsUploaded = false;
     }
+    if(parMap.contains("multi device"))
+        setMultiDevice(parMap.value("multi device").toBool());
+}
+
+const std::vector<float>& VolumeSegmentationFilter::thresholds() const
+{
+    return m_thresholds;
+}
+
+void VolumeSegmentationFilter::setThresholds(std::vector<float> thresholds)
+{
+    m_thresholds = std::move(thresholds);
+    m_thresholdsUploaded = false;
+}
+
+bool VolumeSegmentationFilter::isMultiDevice() const
+{
+    return m_multiDeviceFilter != nullptr;
+}
+
+void VolumeSegmentationFilter::setMultiDevice(bool enabled)
+{
+    if(!enabled)
+        m_multiDeviceFilter.reset();
+    else if(!m_multiDeviceFilter)
+        m_multiDeviceFilter = std::make_shared<MultiDeviceSegmentation>();
+}
+
+// (re-)creates the threshold buffer on the device; only reallocated if the number of thresholds changed
+void VolumeSegmentationFilter::uploadThresholds()
+{
+    const auto bufferSize = sizeof(float) * std::max(m_thresholds.size(), size_t(1)); // no empty buffers
+
+    if(m_thresholdBuffer() == nullptr || m_thresholdBuffer.getInfo<CL_MEM_SIZE>() != bufferSize)
+    {
+        const auto& context = _queue.getInfo<CL_QUEUE_CONTEXT>();
+        m_thresholdBuffer = cl::Buffer(context, CL_MEM_READ_ONLY, bufferSize);
+    }
+    if(!m_thresholds.empty())
+        _queue.enqueueWriteBuffer(m_thresholdBuffer, CL_FALSE, 0, bufferSize, m_thresholds.data());
+
+    m_thresholdsUploaded = true;
 }
 
 
 
 VolumeSegmentationFilter::VolumeSegmentationFilter()
-    : CTL::OCL::GenericOCLVolumeFilter("F:/projects/ctl-tutorials/tutorialA2B/volumesegementationfilter_flexible.cl")
+    : CTL::OCL::GenericOCLVolumeFilter(OCLProgramCache::clFilePath(PLACEHOLDER_CL_FILE))
+    , m_kernel(volumeFilterProgram(SEGMENTATION_CL_FILE, SEGMENTATION_KERNEL), SEGMENTATION_KERNEL.c_str())
+{
+    _queue = profiledQueue(_queue);
+}
+
+OCLMovingAverageFilter::OCLMovingAverageFilter(uint radius)
+    : m_radius(radius)
+{
+    auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    if(!oclConfig.isValid())
+        throw std::runtime_error("OCLMovingAverageFilter: OpenCLConfig is not valid.");
+
+    const auto clSourceCode = OCLProgramCache::loadSourceCode(MOVING_AVERAGE_CL_FILE);
+
+    auto& programs = OCLProgramCache::instance();
+    programs.addKernel(TILED_KERNEL, clSourceCode, MOVING_AVERAGE_PROGRAM);
+    programs.addKernel(LINES_KERNEL, clSourceCode, MOVING_AVERAGE_PROGRAM);
+    programs.addKernel(HALF_TO_FLOAT_KERNEL, clSourceCode, MOVING_AVERAGE_PROGRAM);
+    programs.addKernel(FLOAT_TO_HALF_KERNEL, clSourceCode, MOVING_AVERAGE_PROGRAM);
+
+    m_queue = OCLProfiler::instance().createQueue(oclConfig.context(), oclConfig.devices().front());
+}
+
+void OCLMovingAverageFilter::filter(CTL::VoxelVolume<float>& volume)
+{
+    if(m_halfTransfer)
+        filterData<float, Half>(volume.rawData(), volume.dimensions());
+    else
+        filterData<float, float>(volume.rawData(), volume.dimensions());
+}
+
+void OCLMovingAverageFilter::filter(HalfVolume<Half>& volume)
+{
+    filterData<Half, Half>(volume.data().data(), volume.dimensions());
+}
+
+// host data of type HostT (float or Half), transferred as TransferT (float or Half); half
+// transfers are converted from/to the float buffers on the device
+template<typename HostT, typename TransferT>
+void OCLMovingAverageFilter::filterData(HostT* data, const CTL::VoxelVolume<float>::Dimensions& dim)
+{
+    if(m_radius == 0)
+        return;
+
+    const auto halfTransfer = std::is_same<TransferT, Half>::value;
+    const auto sameType = std::is_same<HostT, TransferT>::value;
+
+    try {
+
+        const auto sliceSize = size_t(dim.x) * dim.y;
+        const auto sliceBytes = sliceSize * sizeof(float);
+        const auto transferSliceBytes = sliceSize * sizeof(TransferT);
+        const auto context = m_queue.getInfo<CL_QUEUE_CONTEXT>();
+        const auto device = m_queue.getInfo<CL_QUEUE_DEVICE>();
+
+        // z-slabs (incl. halo of 'm_radius' slices on both sides) that fit into a single buffer
+        const auto maxSlices = static_cast<uint>(std::min<cl_ulong>(
+                    device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sliceBytes, dim.z));
+        const auto thickness = maxSlices == dim.z ? dim.z : maxSlices - std::min(maxSlices, 2 * m_radius);
+        if(thickness < std::min(m_radius, dim.z) || thickness == 0)
+        {
+            qCritical() << "Could not apply OCLMovingAverageFilter. Slices do not fit into device memory "
+                           "for radius" << m_radius;
+            return;
+        }
+
+        const auto bufferSlices = std::min(thickness + 2 * m_radius, dim.z);
+        cl::Buffer input(context, CL_MEM_READ_WRITE, bufferSlices * sliceBytes);
+        cl::Buffer output(context, CL_MEM_READ_WRITE, bufferSlices * sliceBytes);
+        cl::Buffer transfer = halfTransfer ? cl::Buffer(context, CL_MEM_READ_WRITE, bufferSlices * transferSliceBytes)
+                                           : input;
+        std::vector<TransferT> staging; // host data converted for the upload (if different types)
+
+        // the result of a slab is written back to the volume after the next slab has been uploaded
+        // (the next slab's lower halo overlaps with it); requires thickness >= radius
+        std::vector<TransferT> pendingResult;
+        uint pendingZ = 0;
+
+        for(uint z0 = 0; z0 < dim.z; z0 += thickness)
+        {
+            const auto z1 = std::min(z0 + thickness, dim.z);
+            const auto nbLower = std::min(m_radius, z0);
+            const auto nbUpper = std::min(m_radius, dim.z - z1);
+            const auto nbSlices = nbLower + (z1 - z0) + nbUpper;
+
+            const auto slab = data + (z0 - nbLower) * sliceSize;
+            if(!sameType)
+            {
+                staging.resize(nbSlices * sliceSize);
+                convertPrecision(slab, staging.data(), staging.size());
+            }
+            m_queue.enqueueWriteBuffer(transfer, CL_TRUE, 0, nbSlices * transferSliceBytes,
+                                       sameType ? static_cast<const void*>(slab) : staging.data());
+            if(halfTransfer)
+                convert(HALF_TO_FLOAT_KERNEL, transfer, input, 0, nbSlices * sliceSize);
+            if(!pendingResult.empty())
+                convertPrecision(pendingResult.data(), data + pendingZ * sliceSize, pendingResult.size());
+
+            filterSlab(input, output, dim.x, dim.y, nbSlices);
+
+            const auto resultOffset = (z1 == dim.z && z0 == 0) ? 0 : nbLower * sliceSize;
+            const auto resultSize = (z1 - z0) * sliceSize;
+            if(halfTransfer)
+                convert(FLOAT_TO_HALF_KERNEL, output, transfer, resultOffset, resultSize);
+            const auto& result = halfTransfer ? transfer : output;
+            const auto resultBytesOffset = halfTransfer ? 0 : resultOffset * sizeof(TransferT);
+
+            if(z1 == dim.z && z0 == 0 && sameType) // single slab -> directly into the volume
+            {
+                m_queue.enqueueReadBuffer(result, CL_TRUE, resultBytesOffset, resultSize * sizeof(TransferT), data);
+                return;
+            }
+
+            pendingResult.resize(resultSize);
+            m_queue.enqueueReadBuffer(result, CL_TRUE, resultBytesOffset, resultSize * sizeof(TransferT),
+                                      pendingResult.data());
+            pendingZ = z0;
+        }
+
+        convertPrecision(pendingResult.data(), data + pendingZ * sliceSize, pendingResult.size());
+
+    }  catch (const cl::Error& err) {
+        qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
+    }
+}
+
+uint OCLMovingAverageFilter::radius() const
+{
+    return m_radius;
+}
+
+void OCLMovingAverageFilter::setRadius(uint radius)
+{
+    m_radius = radius;
+}
+
+bool OCLMovingAverageFilter::halfPrecisionTransfer() const
+{
+    return m_halfTransfer;
+}
+
+void OCLMovingAverageFilter::setHalfPrecisionTransfer(bool enabled)
+{
+    m_halfTransfer = enabled;
+}
+
+QVariant OCLMovingAverageFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("radius", m_radius);
+    parMap.insert("half precision transfer", m_halfTransfer);
+
+    return parMap;
+}
+
+void OCLMovingAverageFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("radius"))
+        m_radius = parMap.value("radius").toUInt();
+    if(parMap.contains("half precision transfer"))
+        m_halfTransfer = parMap.value("half precision transfer").toBool();
+}
+
+// filters the 'nbSlices' slices in 'input' (as an individual volume); the result ends up in 'output'
+void OCLMovingAverageFilter::filterSlab(cl::Buffer& input, cl::Buffer& output, uint dimX, uint dimY,
+                                        uint nbSlices)
+{
+    auto& programs = OCLProgramCache::instance();
+
+    cl::NDRange localSize;
+    if(tileFitsLocalMemory(localSize))
+    {
+        const auto tx = localSize[0], ty = localSize[1], tz = localSize[2];
+        const auto haloX = tx + 2 * m_radius, haloY = ty + 2 * m_radius, haloZ = tz + 2 * m_radius;
+        const auto roundUp = [] (size_t n, size_t multiple) { return (n + multiple - 1) / multiple * multiple; };
+
+        auto kernel = programs.kernel(TILED_KERNEL, MOVING_AVERAGE_PROGRAM);
+        kernel.setArg(0, input);
+        kernel.setArg(1, output);
+        kernel.setArg(2, dimX);
+        kernel.setArg(3, dimY);
+        kernel.setArg(4, nbSlices);
+        kernel.setArg(5, m_radius);
+        kernel.setArg(6, cl::Local(haloX * haloY * haloZ * sizeof(float)));
+        kernel.setArg(7, cl::Local(tx * haloY * haloZ * sizeof(float)));
+
+        const cl::NDRange globalSize(roundUp(dimX, tx), roundUp(dimY, ty), roundUp(nbSlices, tz));
+        m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize);
+        m_queue.finish();
+        return;
+    }
+
+    // three 1D passes: x (input -> output), y (output -> input), z (input -> output)
+    auto kernel = programs.kernel(LINES_KERNEL, MOVING_AVERAGE_PROGRAM);
+    const auto sliceSize = cl_ulong(dimX) * dimY;
+    const auto pass = [&] (cl::Buffer& src, cl::Buffer& dst, uint n, cl_ulong stride,
+                           size_t nbLines0, cl_ulong lineStride0, size_t nbLines1, cl_ulong lineStride1) {
+        kernel.setArg(0, src);
+        kernel.setArg(1, dst);
+        kernel.setArg(2, n);
+        kernel.setArg(3, stride);
+        kernel.setArg(4, lineStride0);
+        kernel.setArg(5, lineStride1);
+        kernel.setArg(6, m_radius);
+
+        const cl::NDRange globalSize(nbLines0, nbLines1);
+        const auto localSize = WorkGroupTuner::instance().localSize(
+                    MOVING_AVERAGE_PROGRAM + ":" + LINES_KERNEL, kernel, m_queue, globalSize,
+                    [&] (const cl::NDRange& local) {
+                        m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, local); });
+        m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize);
+    };
+
+    pass(input, output, dimX, 1, dimY, dimX, nbSlices, sliceSize);
+    pass(output, input, dimY, dimX, dimX, 1, nbSlices, sliceSize);
+    pass(input, output, nbSlices, sliceSize, dimX, 1, dimY, dimX);
+    m_queue.finish();
+}
+
+// converts 'nbElements' elements from 'src' (starting at 'srcOffset') to the beginning of 'dst'
+// (half <-> float, see kernels half_to_float and float_to_half)
+void OCLMovingAverageFilter::convert(const std::string& kernelName, const cl::Buffer& src, const cl::Buffer& dst,
+                                     size_t srcOffset, size_t nbElements)
+{
+    auto kernel = OCLProgramCache::instance().kernel(kernelName, MOVING_AVERAGE_PROGRAM);
+    kernel.setArg(0, src);
+    kernel.setArg(1, dst);
+    kernel.setArg(2, cl_ulong(srcOffset));
+
+    const cl::NDRange globalSize(nbElements);
+    const auto localSize = WorkGroupTuner::instance().localSize(
+                MOVING_AVERAGE_PROGRAM + ":" + kernelName, kernel, m_queue, globalSize,
+                [&] (const cl::NDRange& local) { m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, local); });
+    m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize);
+}
+
+// work-group size for the tiled kernel; false if the tile does not fit into local memory
+bool OCLMovingAverageFilter::tileFitsLocalMemory(cl::NDRange& localSize) const
+{
+    const auto device = m_queue.getInfo<CL_QUEUE_DEVICE>();
+    const auto kernel = OCLProgramCache::instance().kernel(TILED_KERNEL, MOVING_AVERAGE_PROGRAM);
+
+    const auto maxItems = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    const auto localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>()
+                          - kernel.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE>(device);
+
+    // reduce the tile in z-direction if the device supports smaller work-groups only
+    auto tz = size_t(TILE_Z);
+    while(tz > 1 && TILE_X * TILE_Y * tz > maxItems)
+        tz /= 2;
+    if(TILE_X * TILE_Y * tz > maxItems)
+        return false;
+
+    const auto haloX = TILE_X + 2 * m_radius, haloY = TILE_Y + 2 * m_radius, haloZ = tz + 2 * m_radius;
+    const auto requiredMem = (haloX + TILE_X) * haloY * haloZ * sizeof(float);
+    if(requiredMem > localMem)
+        return false;
+
+    localSize = cl::NDRange(TILE_X, TILE_Y, tz);
+    return true;
+}
+
+MultiDeviceOCLVolumeFilter::MultiDeviceOCLVolumeFilter(const std::string& clFileName, std::vector<float> arguments,
+                                                       uint halo)
+    : MultiDeviceOCLVolumeFilter()
+{
+    m_clFileName = clFileName;
+    m_arguments = std::move(arguments);
+    m_halo = halo;
+    loadKernel();
+}
+
+MultiDeviceOCLVolumeFilter::MultiDeviceOCLVolumeFilter()
+{
+    auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    if(!oclConfig.isValid())
+        throw std::runtime_error("MultiDeviceOCLVolumeFilter: OpenCLConfig is not valid.");
+
+    for(const auto& device : oclConfig.devices())
+        m_queues.push_back(OCLProfiler::instance().createQueue(oclConfig.context(), device));
+}
+
+// phase 1 (all devices concurrently): upload and filter the slab of each device
+// phase 2 (all devices concurrently): download the inner slices of each slab; only after all
+//         uploads are done, since the halo slices of a slab are inner slices of its neighbors
+void MultiDeviceOCLVolumeFilter::filter(CTL::VoxelVolume<float>& volume)
+{
+    if(m_kernels.size() != m_queues.size())
+    {
+        qCritical() << "MultiDeviceOCLVolumeFilter: no kernel loaded.";
+        return;
+    }
+
+    try {
+
+        const auto& dim = volume.dimensions();
+        const auto sliceSize = size_t(dim.x) * dim.y;
+        const auto sliceBytes = sliceSize * sizeof(float);
+        const auto& context = CTL::OCL::OpenCLConfig::instance().context();
+        const auto deviceSlabs = slabs(dim.z);
+
+        std::vector<cl::Buffer> results(m_queues.size());
+        std::vector<double> seconds(m_queues.size(), 0.0);
+        const auto secondsSince = [] (std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        onAllDevices(m_queues.size(), [&] (size_t dev) {
+            const auto& s = deviceSlabs[dev];
+            if(s.nbInner == 0)
+                return;
+
+            auto& queue = m_queues[dev];
+            auto& kernel = m_kernels[dev];
+
+            cl::Image3D input(context, CL_MEM_READ_ONLY, cl::ImageFormat(CL_R, CL_FLOAT), dim.x, dim.y, s.nbSlices());
+            results[dev] = cl::Buffer(context, CL_MEM_WRITE_ONLY, s.nbSlices() * sliceBytes);
+
+            kernel.setArg(0, input);
+            kernel.setArg(1, results[dev]);
+            kernel.setArg(2, s.nbLower);
+            setAdditionalArguments(kernel);
+
+            // tuned before the timed section (the tuning launches would distort the device speed);
+            // the image content does not matter for the timing
+            const cl::NDRange globalSize(dim.x, dim.y);
+            const auto localSize = WorkGroupTuner::instance().localSize(
+                        "MultiDeviceOCLVolumeFilter:" + m_clFileName, kernel, queue, globalSize,
+                        [&] (const cl::NDRange& local) {
+                            queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, local); });
+
+            const auto start = std::chrono::steady_clock::now();
+            cl::size_t<3> origin, region;
+            region[0] = dim.x;
+            region[1] = dim.y;
+            region[2] = s.nbSlices();
+            auto& profiler = OCLProfiler::instance();
+            queue.enqueueWriteImage(input, CL_FALSE, origin, region, 0, 0,
+                                    volume.rawData() + s.firstSlice * sliceSize, nullptr,
+                                    profiler.event("MultiDeviceOCLVolumeFilter upload"));
+
+            for(uint z = s.nbLower; z < s.nbLower + s.nbInner; ++z)
+            {
+                kernel.setArg(2, z);
+                queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize, nullptr,
+                                           profiler.event("MultiDeviceOCLVolumeFilter kernel"));
+            }
+            queue.finish();
+
+            seconds[dev] = secondsSince(start);
+        });
+
+        onAllDevices(m_queues.size(), [&] (size_t dev) {
+            const auto& s = deviceSlabs[dev];
+            if(s.nbInner == 0)
+                return;
+
+            const auto start = std::chrono::steady_clock::now();
+            m_queues[dev].enqueueReadBuffer(results[dev], CL_TRUE, s.nbLower * sliceBytes, s.nbInner * sliceBytes,
+                                            volume.rawData() + (s.firstSlice + s.nbLower) * sliceSize, nullptr,
+                                            OCLProfiler::instance().event("MultiDeviceOCLVolumeFilter download"));
+            seconds[dev] += secondsSince(start);
+        });
+
+        // throughput of each device (averaged with the previous measurement)
+        m_speeds.resize(m_queues.size(), 0.0);
+        for(size_t dev = 0; dev < m_queues.size(); ++dev)
+        {
+            if(deviceSlabs[dev].nbInner == 0 || seconds[dev] <= 0.0)
+                continue;
+            const auto speed = double(deviceSlabs[dev].nbInner) * sliceSize / seconds[dev];
+            m_speeds[dev] = m_speeds[dev] > 0.0 ? 0.5 * (m_speeds[dev] + speed) : speed;
+        }
+
+    }  catch (const cl::Error& err) {
+        qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
+    }
+}
+
+uint MultiDeviceOCLVolumeFilter::nbDevices() const
+{
+    return static_cast<uint>(m_queues.size());
+}
+
+const std::vector<double>& MultiDeviceOCLVolumeFilter::deviceSpeeds() const
+{
+    return m_speeds;
+}
+
+QVariant MultiDeviceOCLVolumeFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("cl file name", QString::fromStdString(m_clFileName));
+    parMap.insert("arguments", QVariantList(m_arguments.cbegin(), m_arguments.cend())); // Note: requires Qt >= 5.14
+    parMap.insert("halo", m_halo);
+
+    return parMap;
+}
+
+void MultiDeviceOCLVolumeFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("arguments"))
+    {
+        const auto arguments = parMap.value("arguments").toList();
+        m_arguments.resize(arguments.size());
+        std::transform(arguments.cbegin(), arguments.cend(), m_arguments.begin(),
+                       [] (const QVariant& value) { return value.toFloat(); });
+    }
+    if(parMap.contains("halo"))
+        m_halo = parMap.value("halo").toUInt();
+    if(parMap.contains("cl file name"))
+    {
+        m_clFileName = parMap.value("cl file name").toString().toStdString();
+        if(!m_clFileName.empty())
+            loadKernel();
+    }
+}
+
+void MultiDeviceOCLVolumeFilter::setAdditionalArguments(cl::Kernel& kernel) const
+{
+    for(uint arg = 0; arg < m_arguments.size(); ++arg)
+        kernel.setArg(3 + arg, m_arguments[arg]);
+}
+
+// builds the program (once for all devices) and creates a kernel object per device
+void MultiDeviceOCLVolumeFilter::loadKernel()
+{
+    const auto program = volumeFilterProgram(m_clFileName, MULTI_DEVICE_KERNEL);
+
+    m_kernels.clear();
+    for(size_t dev = 0; dev < m_queues.size(); ++dev)
+        m_kernels.emplace_back(program, MULTI_DEVICE_KERNEL.c_str());
+}
+
+// splits 'nbSlices' into one slab per device, proportional to the measured device speeds
+// (devices without a measurement count as average)
+std::vector<MultiDeviceOCLVolumeFilter::Slab> MultiDeviceOCLVolumeFilter::slabs(uint nbSlices) const
+{
+    const auto nbDevices = m_queues.size();
+
+    std::vector<double> weights(nbDevices, 1.0);
+    const auto nbMeasured = std::count_if(m_speeds.cbegin(), m_speeds.cend(), [] (double s) { return s > 0.0; });
+    if(nbMeasured > 0)
+    {
+        const auto average = std::accumulate(m_speeds.cbegin(), m_speeds.cend(), 0.0) / nbMeasured;
+        for(size_t dev = 0; dev < nbDevices; ++dev)
+            weights[dev] = dev < m_speeds.size() && m_speeds[dev] > 0.0 ? m_speeds[dev] : average;
+    }
+    const auto totalWeight = std::accumulate(weights.cbegin(), weights.cend(), 0.0);
+
+    std::vector<Slab> ret(nbDevices);
+    auto cumulativeWeight = 0.0;
+    uint begin = 0;
+    for(size_t dev = 0; dev < nbDevices; ++dev)
+    {
+        cumulativeWeight += weights[dev];
+        const auto end = dev + 1 == nbDevices
+                ? nbSlices
+                : std::max(begin, static_cast<uint>(std::lround(nbSlices * cumulativeWeight / totalWeight)));
+
+        auto& s = ret[dev];
+        s.nbLower = std::min(m_halo, begin);
+        s.nbInner = end - begin;
+        s.nbUpper = std::min(m_halo, nbSlices - end);
+        s.firstSlice = begin - s.nbLower;
+        begin = end;
+    }
+
+    return ret;
+}
+
+PipelinedOCLVolumeFilter::PipelinedOCLVolumeFilter(const std::string& clFileName, std::vector<float> arguments,
+                                                   uint halo, uint slicesPerChunk)
+    : PipelinedOCLVolumeFilter()
+{
+    m_clFileName = clFileName;
+    m_arguments = std::move(arguments);
+    m_halo = halo;
+    m_slicesPerChunk = std::max(slicesPerChunk, 1u);
+    loadKernel();
+}
+
+PipelinedOCLVolumeFilter::PipelinedOCLVolumeFilter()
+{
+    auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    if(!oclConfig.isValid())
+        throw std::runtime_error("PipelinedOCLVolumeFilter: OpenCLConfig is not valid.");
+
+    const auto& device = oclConfig.devices().front();
+    const auto& profiler = OCLProfiler::instance();
+    m_uploadQueue = profiler.createQueue(oclConfig.context(), device);
+    m_computeQueue = profiler.createQueue(oclConfig.context(), device);
+    m_downloadQueue = profiler.createQueue(oclConfig.context(), device);
+}
+
+// per chunk c (stage c % 2): host -> pinned input (host copy), pinned input -> device (upload queue),
+// device buffer -> image and kernels (compute queue), result -> pinned output (download queue);
+// the result of chunk c - 1 is copied into the volume while chunk c is in flight
+// -> the input of chunk c is copied before the result of chunk c - 1 overwrites its lower halo
+void PipelinedOCLVolumeFilter::filter(CTL::VoxelVolume<float>& volume)
 {
+    auto kernel = OCLProgramCache::instance().kernel(PIPELINED_KERNEL, "PipelinedOCLVolumeFilter:" + m_clFileName);
+    if(kernel() == nullptr)
+    {
+        qCritical() << "PipelinedOCLVolumeFilter: no kernel loaded.";
+        return;
+    }
+
+    try {
+
+        const auto& dim = volume.dimensions();
+        const auto sliceSize = size_t(dim.x) * dim.y;
+        const auto sliceBytes = sliceSize * sizeof(float);
+        const auto chunkSlices = std::max({ m_slicesPerChunk, m_halo, 1u });
+        const auto nbChunks = (dim.z + chunkSlices - 1) / chunkSlices;
+        const auto& context = CTL::OCL::OpenCLConfig::instance().context();
+
+        allocateStages(std::min(chunkSlices + 2 * m_halo, dim.z) * sliceSize);
+        for(auto& stage : m_stages)
+            stage.imageDepth = 0; // dimensions may differ from the previous call
+
+        for(uint arg = 0; arg < m_arguments.size(); ++arg)
+            kernel.setArg(3 + arg, m_arguments[arg]);
+
+        const cl::NDRange globalSize(dim.x, dim.y);
+        cl::NDRange localSize;
+        auto& profiler = OCLProfiler::instance();
+
+        const auto finishChunk = [&] (uint chunk) {
+            const auto s = slab(chunk, chunkSlices, dim.z);
+            auto& stage = m_stages[chunk % NB_PIPELINE_STAGES];
+            stage.downloaded.wait();
+            std::copy_n(stage.output->hostPtr(), s.nbInner * sliceSize,
+                        volume.rawData() + (s.firstSlice + s.nbLower) * sliceSize);
+        };
+
+        for(uint chunk = 0; chunk < nbChunks; ++chunk)
+        {
+            const auto s = slab(chunk, chunkSlices, dim.z);
+            auto& stage = m_stages[chunk % NB_PIPELINE_STAGES];
+
+            // upload
+            if(stage.copied() != nullptr)
+                stage.copied.wait();
+            std::copy_n(volume.rawData() + s.firstSlice * sliceSize, s.nbSlices() * sliceSize,
+                        stage.input->hostPtr());
+
+            cl::Event uploaded;
+            m_uploadQueue.enqueueWriteBuffer(stage.input->devBuffer(), CL_FALSE, 0, s.nbSlices() * sliceBytes,
+                                             stage.input->hostPtr(), nullptr, &uploaded);
+            m_uploadQueue.flush();
+            profiler.record(uploaded, "PipelinedOCLVolumeFilter upload");
+
+            // compute (the output buffer of this stage must have been downloaded)
+            if(stage.imageDepth != s.nbSlices())
+            {
+                stage.image = cl::Image3D(context, CL_MEM_READ_ONLY, cl::ImageFormat(CL_R, CL_FLOAT),
+                                          dim.x, dim.y, s.nbSlices());
+                stage.imageDepth = s.nbSlices();
+            }
+
+            std::vector<cl::Event> computeWaits{ uploaded };
+            if(stage.downloaded() != nullptr)
+                computeWaits.push_back(stage.downloaded);
+
+            cl::size_t<3> origin, region;
+            region[0] = dim.x;
+            region[1] = dim.y;
+            region[2] = s.nbSlices();
+            m_computeQueue.enqueueCopyBufferToImage(stage.input->devBuffer(), stage.image, 0, origin, region,
+                                                    &computeWaits, &stage.copied);
+            profiler.record(stage.copied, "PipelinedOCLVolumeFilter buffer to image");
+
+            kernel.setArg(0, stage.image);
+            kernel.setArg(1, stage.output->devBuffer());
+            if(chunk == 0)
+            {
+                kernel.setArg(2, s.nbLower);
+                localSize = WorkGroupTuner::instance().localSize(
+                            "PipelinedOCLVolumeFilter:" + m_clFileName, kernel, m_computeQueue, globalSize,
+                            [&] (const cl::NDRange& local) {
+                                m_computeQueue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, local); });
+            }
+            for(uint z = s.nbLower; z < s.nbLower + s.nbInner; ++z)
+            {
+                kernel.setArg(2, z);
+                m_computeQueue.enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, localSize, nullptr,
+                                                    profiler.event("PipelinedOCLVolumeFilter kernel"));
+            }
+
+            cl::Event computed;
+            m_computeQueue.enqueueMarkerWithWaitList(nullptr, &computed);
+            m_computeQueue.flush();
+
+            // download
+            const std::vector<cl::Event> downloadWaits{ computed };
+            m_downloadQueue.enqueueReadBuffer(stage.output->devBuffer(), CL_FALSE, s.nbLower * sliceBytes,
+                                              s.nbInner * sliceBytes, stage.output->hostPtr(), &downloadWaits,
+                                              &stage.downloaded);
+            m_downloadQueue.flush();
+            profiler.record(stage.downloaded, "PipelinedOCLVolumeFilter download");
+
+            if(chunk > 0)
+                finishChunk(chunk - 1);
+        }
+
+        if(nbChunks > 0)
+            finishChunk(nbChunks - 1);
+
+    }  catch (const cl::Error& err) {
+        qCritical() << "OpenCL error:" << err.what() << "(" << err.err() << ")";
+    }
+}
+
+uint PipelinedOCLVolumeFilter::slicesPerChunk() const
+{
+    return m_slicesPerChunk;
+}
+
+void PipelinedOCLVolumeFilter::setSlicesPerChunk(uint nbSlices)
+{
+    m_slicesPerChunk = std::max(nbSlices, 1u);
+}
+
+QVariant PipelinedOCLVolumeFilter::parameter() const
+{
+    auto parMap = CTL::AbstractVolumeFilter::parameter().toMap();
+
+    parMap.insert("cl file name", QString::fromStdString(m_clFileName));
+    parMap.insert("arguments", QVariantList(m_arguments.cbegin(), m_arguments.cend())); // Note: requires Qt >= 5.14
+    parMap.insert("halo", m_halo);
+    parMap.insert("slices per chunk", m_slicesPerChunk);
+
+    return parMap;
+}
+
+void PipelinedOCLVolumeFilter::setParameter(const QVariant& parameter)
+{
+    CTL::AbstractVolumeFilter::setParameter(parameter);
+
+    const auto parMap = parameter.toMap();
+
+    if(parMap.contains("arguments"))
+    {
+        const auto arguments = parMap.value("arguments").toList();
+        m_arguments.resize(arguments.size());
+        std::transform(arguments.cbegin(), arguments.cend(), m_arguments.begin(),
+                       [] (const QVariant& value) { return value.toFloat(); });
+    }
+    if(parMap.contains("halo"))
+        m_halo = parMap.value("halo").toUInt();
+    if(parMap.contains("slices per chunk"))
+        setSlicesPerChunk(parMap.value("slices per chunk").toUInt());
+    if(parMap.contains("cl file name"))
+    {
+        m_clFileName = parMap.value("cl file name").toString().toStdString();
+        if(!m_clFileName.empty())
+            loadKernel();
+    }
+}
+
+void PipelinedOCLVolumeFilter::loadKernel()
+{
+    OCLProgramCache::instance().addKernel(PIPELINED_KERNEL,
+                                          WRITE_BUFFER_HELPER + OCLProgramCache::loadSourceCode(m_clFileName),
+                                          "PipelinedOCLVolumeFilter:" + m_clFileName);
+}
+
+// pinned memory is only reallocated if the chunk size changed (pinning is expensive)
+void PipelinedOCLVolumeFilter::allocateStages(size_t nbElements)
+{
+    if(nbElements == m_stageElements)
+        return;
+
+    m_stages.clear();
+    m_stages.resize(NB_PIPELINE_STAGES);
+    for(auto& stage : m_stages)
+    {
+        stage.input.reset(new CTL::OCL::PinnedBufHostWrite<float>(nbElements, m_uploadQueue));
+        stage.output.reset(new CTL::OCL::PinnedBufHostRead<float>(nbElements, m_downloadQueue));
+    }
+    m_stageElements = nbElements;
+}
+
+PipelinedOCLVolumeFilter::Slab PipelinedOCLVolumeFilter::slab(uint chunk, uint chunkSlices, uint nbSlices) const
+{
+    const auto begin = chunk * chunkSlices;
+    const auto end = std::min(begin + chunkSlices, nbSlices);
+
+    Slab ret;
+    ret.nbLower = std::min(m_halo, begin);
+    ret.nbInner = end - begin;
+    ret.nbUpper = std::min(m_halo, nbSlices - end);
+    ret.firstSlice = begin - ret.nbLower;
+
+    return ret;
 }
@@ -1,8 +1,26 @@
 #ifndef CUSTOMOCLVOLUMEFILTERS_H
 #define CUSTOMOCLVOLUMEFILTERS_H
 
+#include "halfprecision.h"
+
+#include "ocl/pinnedmem.h"
 #include "processing/genericoclvolumefilter.h"
 
+#include <memory>
+
+class MultiDeviceOCLVolumeFilter;
+
+// VolumeSegmentationFilter
+// assigns the value i + 1 to voxels above the i-th threshold (0 below all thresholds)
+// -> the thresholds are uploaded once and kept on the device until they change
+// -> ascending thresholds are searched by bisection in the kernel (for more than a few thresholds)
+// -> setMultiDevice(true) distributes z-slabs over all devices (see MultiDeviceOCLVolumeFilter)
+// -> the kernel is built by the OCLProgramCache (binary cache on disk), the GenericOCLVolumeFilter
+//    base only provides the command queue; workaround, since GenericOCLVolumeFilter always builds
+//    the kernel of its .cl file from source: the base is constructed with a placeholder kernel
+//    (placeholdervolumefilter.cl, cheap to build) and filter() re-implements the launch of
+//    GenericOCLVolumeFilter::filter() (upload as image, one launch per slice) with the own kernel
+// -> profiled by the OCLProfiler: upload, kernels and download, plus a span for the entire call
 class VolumeSegmentationFilter : public CTL::OCL::GenericOCLVolumeFilter
 {
     CTL_TYPE_ID(CTL::OCL::GenericOCLVolumeFilter::UserType + 100)
@@ -15,10 +33,181 @@ public:
     QVariant parameter() const override;
     void setParameter(const QVariant &parameter) override;
 
+    const std::vector<float>& thresholds() const;
+    void setThresholds(std::vector<float> thresholds);
+    bool isMultiDevice() const;
+    void setMultiDevice(bool enabled);
+
 private:
     VolumeSegmentationFilter();
 
+    void uploadThresholds();
+
     std::vector<float> m_thresholds;
+    cl::Kernel m_kernel; // own kernel object (arguments are not shared with other instances)
+    cl::Buffer m_thresholdBuffer;
+    bool m_thresholdsUploaded = false;
+    std::shared_ptr<MultiDeviceOCLVolumeFilter> m_multiDeviceFilter; // null: single device
+};
+
+// OCLMovingAverageFilter
+// OpenCL version of MovingAverageFilter (same result up to floating-point rounding):
+// -> the entire volume (or large z-slabs of it, if it exceeds the device's maximum buffer size)
+//    is processed per launch, using 3D work-groups that filter a tile in local memory
+// -> radii whose tiles do not fit into local memory are processed by three 1D running-sum passes
+// fp16 data: filter(HalfVolume&) transfers the 16 bit data as it is; for fp32 volumes, the transfer
+// in half precision can be enabled by setHalfPrecisionTransfer() (half of the PCIe traffic); the
+// data is converted on the device (vload_half/vstore_half), the filter itself computes in float
+class OCLMovingAverageFilter : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 9)
+
+public:
+    explicit OCLMovingAverageFilter(uint radius = 1);
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+    void filter(HalfVolume<Half>& volume);
+
+    uint radius() const;
+    void setRadius(uint radius);
+    bool halfPrecisionTransfer() const;
+    void setHalfPrecisionTransfer(bool enabled);
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    template<typename HostT, typename TransferT>
+    void filterData(HostT* data, const CTL::VoxelVolume<float>::Dimensions& dim);
+    void filterSlab(cl::Buffer& input, cl::Buffer& output, uint dimX, uint dimY, uint nbSlices);
+    void convert(const std::string& kernelName, const cl::Buffer& src, const cl::Buffer& dst, size_t srcOffset,
+                 size_t nbElements);
+    bool tileFitsLocalMemory(cl::NDRange& localSize) const;
+
+    uint m_radius = 1;
+    bool m_halfTransfer = false;
+    cl::CommandQueue m_queue;
+};
+
+// MultiDeviceOCLVolumeFilter
+// applies a GenericOCLVolumeFilter kernel (same .cl file convention, i.e. a kernel 'filter' with
+// the arguments (oldVol, newVol, z, arg0, arg1, ...), writing by write_bufferf) on all devices
+// of the OpenCLConfig concurrently:
+// -> the volume is split into z-slabs, one per device, each device has its own queue
+// -> slab thicknesses are proportional to the throughput measured for each device in the
+//    previous calls (equal split for the first call)
+// -> kernels that read neighboring voxels require 'halo' additional slices on both sides
+class MultiDeviceOCLVolumeFilter : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 10)
+
+public:
+    explicit MultiDeviceOCLVolumeFilter(const std::string& clFileName, std::vector<float> arguments = {},
+                                        uint halo = 0);
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+
+    uint nbDevices() const;
+    const std::vector<double>& deviceSpeeds() const; // voxels per second (empty before first use)
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+protected:
+    MultiDeviceOCLVolumeFilter();
+
+    // binds the kernel arguments following (oldVol, newVol, z); default: the float arguments
+    virtual void setAdditionalArguments(cl::Kernel& kernel) const;
+
+private:
+    struct Slab
+    {
+        uint firstSlice; // first slice to upload (incl. lower halo)
+        uint nbLower;
+        uint nbInner;
+        uint nbUpper;
+
+        uint nbSlices() const { return nbLower + nbInner + nbUpper; }
+    };
+
+    void loadKernel();
+    std::vector<Slab> slabs(uint nbSlices) const;
+
+    std::string m_clFileName;
+    std::vector<float> m_arguments;
+    uint m_halo = 0;
+    std::vector<cl::CommandQueue> m_queues;
+    std::vector<cl::Kernel> m_kernels; // one per device (setArg is not thread-safe)
+    std::vector<double> m_speeds;
+};
+
+// PipelinedOCLVolumeFilter
+// applies a GenericOCLVolumeFilter kernel (same .cl file convention as MultiDeviceOCLVolumeFilter)
+// to chunks of 'slicesPerChunk' z-slices, streamed through two stages of pinned buffers
+// (PinnedBufHostWrite/PinnedBufHostRead) on three queues of the same device:
+// -> uploading chunk c + 1, computing chunk c and downloading chunk c - 1 overlap, i.e. most of
+//    the transfer time is hidden behind the computation
+// -> kernels that read neighboring voxels require 'halo' additional slices on both sides
+//    (chunks are at least 'halo' slices thick)
+class PipelinedOCLVolumeFilter : public CTL::AbstractVolumeFilter
+{
+    CTL_TYPE_ID(CTL::AbstractVolumeFilter::UserType + 11)
+
+public:
+    explicit PipelinedOCLVolumeFilter(const std::string& clFileName, std::vector<float> arguments = {},
+                                      uint halo = 0, uint slicesPerChunk = 16);
+
+    // AbstractVolumeFilter interface
+    void filter(CTL::VoxelVolume<float> &volume) override;
+
+    uint slicesPerChunk() const;
+    void setSlicesPerChunk(uint nbSlices);
+
+    // de-/serialization
+    QVariant parameter() const override;
+    void setParameter(const QVariant &parameter) override;
+
+private:
+    PipelinedOCLVolumeFilter();
+
+    struct Slab
+    {
+        uint firstSlice; // first slice to upload (incl. lower halo)
+        uint nbLower;
+        uint nbInner;
+        uint nbUpper;
+
+        uint nbSlices() const { return nbLower + nbInner + nbUpper; }
+    };
+
+    // pinned buffers and image of one pipeline stage, reused by every other chunk
+    struct Stage
+    {
+        std::unique_ptr<CTL::OCL::PinnedBufHostWrite<float>> input;
+        std::unique_ptr<CTL::OCL::PinnedBufHostRead<float>> output;
+        cl::Image3D image;
+        uint imageDepth = 0;
+        cl::Event copied;     // input -> image done (pinned input can be refilled)
+        cl::Event downloaded; // output -> pinned host memory done
+    };
+
+    void loadKernel();
+    void allocateStages(size_t nbElements);
+    Slab slab(uint chunk, uint chunkSlices, uint nbSlices) const;
+
+    std::string m_clFileName;
+    std::vector<float> m_arguments;
+    uint m_halo = 0;
+    uint m_slicesPerChunk = 16;
+    cl::CommandQueue m_uploadQueue;
+    cl::CommandQueue m_computeQueue;
+    cl::CommandQueue m_downloadQueue;
+    std::vector<Stage> m_stages;
+    size_t m_stageElements = 0;
 };
 
 #endif // CUSTOMOCLVOLUMEFILTERS_H
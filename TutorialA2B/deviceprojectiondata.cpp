@@ -0,0 +1,156 @@
+#include "deviceprojectiondata.h"
+
+#include <stdexcept>
+#include <utility>
+
+DeviceProjectionData::DeviceProjectionData(const CTL::ProjectionData& projections,
+                                           const cl::CommandQueue& queue)
+    : DeviceProjectionData(projections.dimensions(), queue)
+{
+    upload(projections);
+}
+
+DeviceProjectionData::DeviceProjectionData(const CTL::ProjectionData::Dimensions& dimensions,
+                                           const cl::CommandQueue& queue)
+    : m_dims(dimensions)
+    , m_queue(queue)
+    , m_host(0, 0, 0)
+{
+    if(nbElements() == 0)
+        throw std::domain_error("DeviceProjectionData: empty projection data.");
+
+    m_buffer = cl::Buffer(m_queue.getInfo<CL_QUEUE_CONTEXT>(), CL_MEM_READ_WRITE, nbElements() * sizeof(float));
+    m_deviceValid = true;
+}
+
+DeviceProjectionData::DeviceProjectionData(DeviceProjectionData&& other)
+    : m_dims(other.m_dims)
+    , m_queue(other.m_queue)
+    , m_buffer(other.m_buffer)
+    , m_host(std::move(other.m_host))
+    , m_deviceValid(other.m_deviceValid)
+    , m_hostValid(other.m_hostValid)
+{
+    other.m_buffer = cl::Buffer();
+    other.m_deviceValid = other.m_hostValid = false;
+}
+
+DeviceProjectionData& DeviceProjectionData::operator=(DeviceProjectionData&& other)
+{
+    if(this == &other)
+        return *this;
+
+    m_dims = other.m_dims;
+    m_queue = other.m_queue;
+    m_buffer = other.m_buffer;
+    m_host = std::move(other.m_host);
+    m_deviceValid = other.m_deviceValid;
+    m_hostValid = other.m_hostValid;
+
+    other.m_buffer = cl::Buffer();
+    other.m_deviceValid = other.m_hostValid = false;
+
+    return *this;
+}
+
+const CTL::ProjectionData::Dimensions& DeviceProjectionData::dimensions() const
+{
+    return m_dims;
+}
+
+size_t DeviceProjectionData::nbElements() const
+{
+    return size_t(m_dims.nbChannels) * m_dims.nbRows * m_dims.nbModules * m_dims.nbViews;
+}
+
+const cl::CommandQueue& DeviceProjectionData::queue() const
+{
+    return m_queue;
+}
+
+const cl::Buffer& DeviceProjectionData::deviceBuffer() const
+{
+    syncDevice();
+    return m_buffer;
+}
+
+cl::Buffer& DeviceProjectionData::deviceBuffer()
+{
+    syncDevice();
+    m_hostValid = false;
+    return m_buffer;
+}
+
+const CTL::ProjectionData& DeviceProjectionData::hostData() const
+{
+    syncHost();
+    return m_host;
+}
+
+CTL::ProjectionData& DeviceProjectionData::hostData()
+{
+    syncHost();
+    m_deviceValid = false;
+    return m_host;
+}
+
+void DeviceProjectionData::copyTo(CTL::ProjectionData& projections) const
+{
+    if(projections.dimensions() != m_dims)
+        throw std::domain_error("DeviceProjectionData::copyTo: dimensions do not match.");
+
+    if(m_hostValid)
+        projections = m_host;
+    else
+        download(projections);
+}
+
+// module by module (the modules of a ProjectionData are separate allocations)
+void DeviceProjectionData::upload(const CTL::ProjectionData& projections) const
+{
+    const auto moduleBytes = size_t(m_dims.nbChannels) * m_dims.nbRows * sizeof(float);
+    size_t offset = 0;
+    for(const auto& view : projections.data())
+        for(const auto& module : view.data())
+        {
+            m_queue.enqueueWriteBuffer(m_buffer, CL_FALSE, offset, moduleBytes, module.rawData());
+            offset += moduleBytes;
+        }
+    m_queue.finish();
+}
+
+void DeviceProjectionData::download(CTL::ProjectionData& projections) const
+{
+    const auto moduleBytes = size_t(m_dims.nbChannels) * m_dims.nbRows * sizeof(float);
+    size_t offset = 0;
+    for(auto& view : projections.data())
+        for(auto& module : view.data())
+        {
+            m_queue.enqueueReadBuffer(m_buffer, CL_FALSE, offset, moduleBytes, module.rawData());
+            offset += moduleBytes;
+        }
+    m_queue.finish();
+}
+
+void DeviceProjectionData::syncDevice() const
+{
+    if(m_deviceValid)
+        return;
+
+    upload(m_host);
+    m_deviceValid = true;
+}
+
+void DeviceProjectionData::syncHost() const
+{
+    if(m_hostValid)
+        return;
+
+    if(m_host.dimensions() != m_dims)
+    {
+        m_host = CTL::ProjectionData(m_dims.nbChannels, m_dims.nbRows, m_dims.nbModules);
+        m_host.allocateMemory(m_dims.nbViews);
+    }
+    download(m_host);
+    m_hostValid = true;
+}
@@ -0,0 +1,61 @@
+#ifndef DEVICEPROJECTIONDATA_H
+#define DEVICEPROJECTIONDATA_H
+
+#include "img/projectiondata.h"
+#include "ocl/openclconfig.h"
+
+// DeviceProjectionData
+// projection data that resides in an OpenCL buffer (all modules of all views, one after another);
+// a host copy is created (downloaded) only when the host data is actually accessed:
+// -> deviceBuffer() uploads the host data if it is newer than the device data;
+//    the non-const version marks the host copy as outdated (the caller writes to the buffer)
+// -> hostData() downloads the device data if it is newer than the host copy;
+//    the non-const version marks the device data as outdated (the caller writes to the host data)
+// -> chains of the tutorial's OpenCL filters (see AbstractOCLProjectionFilter) thus exchange the
+//    projections on the device, the data is transferred to the host only once at the end
+// -> limitation: the CTL's OCL::RayCasterProjector, OCL::FDKReconstructor and ARTReconstructor work
+//    on host-side ProjectionData only; projecting or reconstructing still forces a download (and the
+//    CTL class uploads the data again), i.e. a filter -> FDK chain saves no transfers so far
+// -> not copyable (copies would share the buffer, but not the validity of the host/device data);
+//    moves leave the source empty
+class DeviceProjectionData
+{
+public:
+    // uploads the projections
+    DeviceProjectionData(const CTL::ProjectionData& projections, const cl::CommandQueue& queue);
+    // allocates (uninitialized) device memory only
+    DeviceProjectionData(const CTL::ProjectionData::Dimensions& dimensions, const cl::CommandQueue& queue);
+
+    DeviceProjectionData(const DeviceProjectionData&) = delete;
+    DeviceProjectionData(DeviceProjectionData&& other);
+    DeviceProjectionData& operator=(const DeviceProjectionData&) = delete;
+    DeviceProjectionData& operator=(DeviceProjectionData&& other);
+
+    const CTL::ProjectionData::Dimensions& dimensions() const;
+    size_t nbElements() const;
+    const cl::CommandQueue& queue() const;
+
+    const cl::Buffer& deviceBuffer() const;
+    cl::Buffer& deviceBuffer();
+
+    const CTL::ProjectionData& hostData() const;
+    CTL::ProjectionData& hostData();
+
+    // downloads the data into 'projections' (must have the same dimensions), without a host copy
+    void copyTo(CTL::ProjectionData& projections) const;
+
+private:
+    void upload(const CTL::ProjectionData& projections) const;
+    void download(CTL::ProjectionData& projections) const;
+    void syncDevice() const;
+    void syncHost() const;
+
+    CTL::ProjectionData::Dimensions m_dims;
+    cl::CommandQueue m_queue;
+    mutable cl::Buffer m_buffer;
+    mutable CTL::ProjectionData m_host;
+    mutable bool m_deviceValid = false;
+    mutable bool m_hostValid = false;
+};
+
+#endif // DEVICEPROJECTIONDATA_H
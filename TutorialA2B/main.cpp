@@ -6,8 +6,13 @@
 #include "ctl_ocl.h"
 #include "ctl_qtgui.h"
 
+#include "asyncfilter.h"
+#include "compileddatamodel.h"
+#include "customoclprojectionfilters.h"
 #include "customvolumefilters.h"
 #include "customoclvolumefilters.h"
+#include "oclprofiler.h"
+#include "oclprogramcache.h"
 
 // helper functions
 void testSerialization(CTL::AbstractVolumeFilter& filter, const CTL::VoxelVolume<float>& image);
@@ -19,6 +24,10 @@ std::shared_ptr<CTL::AbstractDataModel> piecewiseConstantModel();
 // implementations
 void tutorialA2B_1();
 void tutorialA2B_2();
+void tutorialA2B_3();
+void tutorialA2B_4();
+void tutorialA2B_5();
+void tutorialA2B_6();
 
 
 int main(int argc, char *argv[])
@@ -32,6 +41,10 @@ int main(int argc, char *argv[])
 
         tutorialA2B_1();
         tutorialA2B_2();
+        tutorialA2B_3();
+        tutorialA2B_4();
+        tutorialA2B_5();
+        tutorialA2B_6();
 
     }  catch (std::exception& err) {
         qCritical() << err.what();
@@ -45,9 +58,22 @@ void tutorialA2B_1()
     // CPU version (see Tutorial A2's MaskingFilter)
 
     // GPU version
-    const auto clFileName = std::string("F:/projects/ctl-tutorials/tutorialA2B/projectionmaskingfilter.cl");
-    auto filter = std::make_shared<CTL::OCL::GenericOCLProjectionFilter>(clFileName, std::vector<float>{100.0f, 300.0f, 400.0f, 400.0f});
+    // (kernels embedded from kernels.qrc; a path to a .cl file on disk works as well)
+    const auto clFileName = std::string("projectionmaskingfilter.cl");
+    auto filter = std::make_shared<CTL::OCL::GenericOCLProjectionFilter>(OCLProgramCache::clFilePath(clFileName), std::vector<float>{100.0f, 300.0f, 400.0f, 400.0f});
     useProjectionFilter(filter);
+
+    // GPU version with a single launch for a block of views (batched kernel 'filter_batch')
+    const auto batchClFileName = std::string("projectionmaskingfilter_batch.cl");
+    auto batchedFilter = std::make_shared<BatchedOCLProjectionFilter>(batchClFileName, std::vector<float>{100.0f, 300.0f, 400.0f, 400.0f});
+    useProjectionFilter(batchedFilter);
+
+    // same with half-precision transfers (kernel 'filter_batch_half')
+    batchedFilter->setHalfPrecisionTransfer(true);
+    useProjectionFilter(batchedFilter);
+
+    // per-view kernels (without 'filter_batch') are still applied view by view
+    useProjectionFilter(std::make_shared<BatchedOCLProjectionFilter>(clFileName, std::vector<float>{100.0f, 300.0f, 400.0f, 400.0f}));
 }
 
 void tutorialA2B_2()
@@ -58,8 +84,12 @@ void tutorialA2B_2()
     auto filter = std::make_shared<ModelApplicationFilter>(segmentationModel);
     useVolumeFilter(filter);
 
+    // CPU version with a compiled model (flat interval table instead of a tree of summed models)
+    auto compiledModel = std::make_shared<CompiledDataModel>(segmentationModel, 0.0f, 1.0f);
+    useVolumeFilter(std::make_shared<ModelApplicationFilter>(compiledModel));
+
     // GPU version 1: fixed number of three thresholds
-    const auto clFileName = std::string("F:/projects/ctl-tutorials/tutorialA2B/volumesegmentationfilter.cl");
+    const auto clFileName = OCLProgramCache::clFilePath("volumesegmentationfilter.cl");
     auto filter2 = std::make_shared<CTL::OCL::GenericOCLVolumeFilter>(clFileName, std::vector<float>{0.2f, 0.9f, 1.0f});
     useVolumeFilter(filter2);
 
@@ -67,8 +97,102 @@ void tutorialA2B_2()
     const auto filter3 = std::make_shared<VolumeSegmentationFilter>(std::vector<float>{0.1f, 0.25f, 0.5f, 0.9f, 1.0f});
     useVolumeFilter(filter3);
 
+    // GPU version 2 on all devices (z-slabs sized by the measured speed of each device)
+    filter3->setMultiDevice(true);
+    useVolumeFilter(filter3);
+
+    // same for any GenericOCLVolumeFilter kernel
+    useVolumeFilter(std::make_shared<MultiDeviceOCLVolumeFilter>("volumesegmentationfilter.cl",
+                                                                 std::vector<float>{0.2f, 0.9f, 1.0f}));
+
+    // same kernel with overlapping upload, computation and download of chunks of slices
+    useVolumeFilter(std::make_shared<PipelinedOCLVolumeFilter>("volumesegmentationfilter.cl",
+                                                               std::vector<float>{0.2f, 0.9f, 1.0f}));
+
+}
+
+void tutorialA2B_3()
+{
+    // CPU version (see Tutorial A2's MovingAverageFilter)
+    useVolumeFilter(std::make_shared<MovingAverageFilter>(2));
+
+    // GPU version: entire volume per launch, tiles in local memory
+    auto oclFilter = std::make_shared<OCLMovingAverageFilter>(2);
+    useVolumeFilter(oclFilter);
+
+    // same with half-precision transfers (converted on the device)
+    oclFilter->setHalfPrecisionTransfer(true);
+    useVolumeFilter(oclFilter);
 }
 
+void tutorialA2B_4()
+{
+    // filters working on device-resident projections
+    auto setup = CTL::AcquisitionSetup(CTL::makeCTSystem<CTL::blueprints::GenericCarmCT>
+                                       (CTL::DetectorBinning::Binning4x4), 100);
+    setup.applyPreparationProtocol(CTL::protocols::ShortScanTrajectory(700.0));
+    const auto volume = CTL::VoxelVolume<float>::cube(100, 1.0f, 0.02f);
+    const auto projections = CTL::makeProjector<CTL::OCL::RayCasterProjector>()->configureAndProject(setup, volume);
+
+    // single upload, both filters are applied on the device (no transfers in between)
+    OCLProjectionMaskingFilter outerMask(QRect(20, 20, 270, 200));
+    OCLProjectionMaskingFilter innerMask(QRect(50, 40, 210, 160));
+    const auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    DeviceProjectionData deviceProjections(projections, OCLProfiler::instance().createQueue(oclConfig.context(),
+                                                                                            oclConfig.devices().front()));
+    outerMask.filter(deviceProjections);
+    innerMask.filter(deviceProjections);
+
+    // the data is downloaded once, when it is read for the first time
+    CTL::gui::plot(deviceProjections.hostData());
+
+    useProjectionFilter(std::make_shared<OCLProjectionMaskingFilter>(QRect(100, 300, 300, 100)));
+}
+
+void tutorialA2B_5()
+{
+    // asynchronous filtering: the next volume is generated on the CPU while the GPU filters the current one
+    auto filter = std::make_shared<VolumeSegmentationFilter>(std::vector<float>{0.1f, 0.25f, 0.5f, 0.9f, 1.0f});
+    const auto randomVolume = [] {
+        auto volume = CTL::VoxelVolume<float>::cube(100, 1.0f, 0.0f);
+        std::generate(volume.begin(), volume.end(),
+                      [] { return QRandomGenerator::global()->bounded(1.0f); });
+        return volume;
+    };
+
+    std::vector<std::future<CTL::VoxelVolume<float>>> results;
+    for(int i = 0; i < 4; ++i)
+        results.push_back(filterAsync(filter, randomVolume())); // returns immediately
+
+    for(auto& result : results)
+        CTL::gui::plot(result.get()); // blocks until this volume is done
+}
+
+void tutorialA2B_6()
+{
+    // profiling of the OpenCL commands (must be enabled before the filters create their queues)
+    auto& profiler = OCLProfiler::instance();
+    profiler.setEnabled(true);
+    profiler.clear();
+
+    auto volume = CTL::VoxelVolume<float>::cube(256, 1.0f, 0.0f);
+    std::generate(volume.begin(), volume.end(), [] { return QRandomGenerator::global()->bounded(1.0f); });
+
+    // (three thresholds: the kernel has the arguments thresh1..thresh3)
+    PipelinedOCLVolumeFilter filter("volumesegmentationfilter.cl", std::vector<float>{0.2f, 0.9f, 1.0f});
+    filter.filter(volume);
+
+    // single queue, plus a span ("VolumeSegmentationFilter call") from the first to the last command
+    VolumeSegmentationFilter segmentation(std::vector<float>{0.1f, 0.25f, 0.5f, 0.9f, 1.0f});
+    segmentation.filter(volume);
+
+    // time per command (upload, buffer to image, kernel, download) -> overlap of the three queues
+    profiler.summary();
+    // open in chrome://tracing or https://ui.perfetto.dev
+    profiler.writeChromeTrace("tutorialA2B_trace.json");
+
+    profiler.setEnabled(false);
+}
 
 // ###################
 // ##### HELPER ######
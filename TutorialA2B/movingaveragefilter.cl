@@ -0,0 +1,151 @@
+// maps 'i' into [0, n-1] by mirroring at the borders (-1 -> 1, n -> n-2),
+// same boundary handling as in the CPU version (MovingAverageFilter)
+int mirrored(int i, int n)
+{
+    if(n == 1)
+        return 0;
+
+    const int period = 2 * (n - 1);
+    i %= period;
+    if(i < 0)
+        i += period;
+
+    return i < n ? i : period - i;
+}
+
+// 3D box filter, one tile per work-group:
+// the tile plus halo is loaded into local memory and filtered separably (x, y, z) in there
+// -> 'tile' holds (tx+2r)*(ty+2r)*(tz+2r) floats, 'tmp' holds tx*(ty+2r)*(tz+2r) floats
+// -> work items outside of the volume take part in loading and in all barriers, they only
+//    skip writing their result (required on CPU runtimes such as pocl)
+kernel void moving_average_tiled( global const float* vol,
+                                  global float* newVol,
+                                  uint dimX,
+                                  uint dimY,
+                                  uint dimZ,
+                                  uint radius,
+                                  local float* tile,
+                                  local float* tmp)
+{
+    const int r = radius;
+    const int tx = get_local_size(0);
+    const int ty = get_local_size(1);
+    const int tz = get_local_size(2);
+    const int hx = tx + 2 * r;
+    const int hy = ty + 2 * r;
+    const int hz = tz + 2 * r;
+    const int nbItems = tx * ty * tz;
+
+    const int lx = get_local_id(0);
+    const int ly = get_local_id(1);
+    const int lz = get_local_id(2);
+    const int lid = lx + tx * (ly + ty * lz);
+
+    // origin of the tile incl. halo
+    const int x0 = get_group_id(0) * tx - r;
+    const int y0 = get_group_id(1) * ty - r;
+    const int z0 = get_group_id(2) * tz - r;
+
+    // load tile and halo (mirrored at the volume borders)
+    for(int i = lid; i < hx * hy * hz; i += nbItems)
+    {
+        const int gx = mirrored(x0 + i % hx, dimX);
+        const int gy = mirrored(y0 + (i / hx) % hy, dimY);
+        const int gz = mirrored(z0 + i / (hx * hy), dimZ);
+        tile[i] = vol[gx + dimX * (gy + (size_t)dimY * gz)];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // sums along x: tile -> tmp (tx * hy * hz)
+    for(int i = lid; i < tx * hy * hz; i += nbItems)
+    {
+        local const float* row = tile + (i / tx) * hx + i % tx;
+        float sum = 0.0f;
+        for(int k = 0; k <= 2 * r; ++k)
+            sum += row[k];
+        tmp[i] = sum;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // sums along y: tmp -> tile (tx * ty * hz)
+    for(int i = lid; i < tx * ty * hz; i += nbItems)
+    {
+        const int ix = i % tx;
+        const int iy = (i / tx) % ty;
+        const int iz = i / (tx * ty);
+        local const float* col = tmp + ix + tx * (iy + hy * iz);
+        float sum = 0.0f;
+        for(int k = 0; k <= 2 * r; ++k)
+            sum += col[k * tx];
+        tile[i] = sum;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // sums along z (own voxel only)
+    local const float* line = tile + lx + tx * (ly + ty * lz);
+    float sum = 0.0f;
+    for(int k = 0; k <= 2 * r; ++k)
+        sum += line[k * tx * ty];
+
+    const size_t x = get_global_id(0);
+    const size_t y = get_global_id(1);
+    const size_t z = get_global_id(2);
+    if(x < dimX && y < dimY && z < dimZ)
+    {
+        const float norm = 1.0f / (float)((2 * r + 1) * (2 * r + 1) * (2 * r + 1));
+        newVol[x + dimX * (y + dimY * z)] = sum * norm;
+    }
+}
+
+// 1D box filter along lines of 'n' elements with a distance of 'stride' in between
+// (used if the tile for a large radius does not fit into local memory):
+// the line of work item (i, j) starts at i * lineStride0 + j * lineStride1;
+// running sum with compensation of the rounding error -> cost does not depend on the radius
+kernel void moving_average_lines( global const float* vol,
+                                  global float* newVol,
+                                  uint n,
+                                  ulong stride,
+                                  ulong lineStride0,
+                                  ulong lineStride1,
+                                  uint radius)
+{
+    const int r = radius;
+    const float norm = 1.0f / (float)(2 * r + 1);
+
+    global const float* src = vol + get_global_id(0) * lineStride0 + get_global_id(1) * lineStride1;
+    global float* dst = newVol + get_global_id(0) * lineStride0 + get_global_id(1) * lineStride1;
+
+    float sum = 0.0f;
+    float comp = 0.0f;
+    for(int k = -r; k <= r; ++k)
+    {
+        const float y = src[mirrored(k, n) * stride] - comp;
+        const float t = sum + y;
+        comp = (t - sum) - y;
+        sum = t;
+    }
+    dst[0] = sum * norm;
+
+    for(int i = 1; i < (int)n; ++i)
+    {
+        const float y = (src[mirrored(i + r, n) * stride] - src[mirrored(i - r - 1, n) * stride]) - comp;
+        const float t = sum + y;
+        comp = (t - sum) - y;
+        sum = t;
+        dst[i * stride] = sum * norm;
+    }
+}
+
+// fp16 <-> fp32 conversion of half-precision transfers (1D: one element per work-item);
+// element 'srcOffset + i' of 'src' is converted to element 'i' of 'dst'
+kernel void half_to_float(global const half* src, global float* dst, ulong srcOffset)
+{
+    const size_t i = get_global_id(0);
+    dst[i] = vload_half(srcOffset + i, src);
+}
+
+kernel void float_to_half(global const float* src, global half* dst, ulong srcOffset)
+{
+    const size_t i = get_global_id(0);
+    vstore_half_rte(src[srcOffset + i], i, dst);
+}
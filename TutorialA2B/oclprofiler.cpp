@@ -0,0 +1,270 @@
+#include "oclprofiler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+namespace {
+
+QString commandType(cl_command_type type)
+{
+    switch(type)
+    {
+    case CL_COMMAND_NDRANGE_KERNEL:     return QStringLiteral("kernel");
+    case CL_COMMAND_WRITE_BUFFER:
+    case CL_COMMAND_WRITE_IMAGE:        return QStringLiteral("write");
+    case CL_COMMAND_READ_BUFFER:
+    case CL_COMMAND_READ_IMAGE:         return QStringLiteral("read");
+    case CL_COMMAND_COPY_BUFFER:
+    case CL_COMMAND_COPY_IMAGE:
+    case CL_COMMAND_COPY_BUFFER_TO_IMAGE:
+    case CL_COMMAND_COPY_IMAGE_TO_BUFFER: return QStringLiteral("copy");
+    case CL_COMMAND_MAP_BUFFER:
+    case CL_COMMAND_MAP_IMAGE:
+    case CL_COMMAND_UNMAP_MEM_OBJECT:   return QStringLiteral("map");
+    case CL_COMMAND_MARKER:             return QStringLiteral("marker");
+    default:                            return QStringLiteral("other");
+    }
+}
+
+double milliseconds(cl_ulong nanoseconds)
+{
+    return nanoseconds * 1.0e-6;
+}
+
+} // unnamed namespace
+
+OCLProfiler& OCLProfiler::instance()
+{
+    static OCLProfiler instance;
+    return instance;
+}
+
+OCLProfiler::OCLProfiler()
+    : m_enabled(qEnvironmentVariableIntValue("CTL_OCL_PROFILING") != 0)
+{
+}
+
+bool OCLProfiler::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void OCLProfiler::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+cl::CommandQueue OCLProfiler::createQueue(const cl::Context& context, const cl::Device& device) const
+{
+    return cl::CommandQueue(context, device, isEnabled() ? CL_QUEUE_PROFILING_ENABLE : 0);
+}
+
+OCLProfiler::EventHandle OCLProfiler::event(const QString& name)
+{
+    EventHandle ret;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_enabled || isFull())
+        return ret;
+
+    ret.m_event = std::make_shared<cl::Event>();
+    m_commands.push_back({ name, ret.m_event, cl::Event() });
+    return ret;
+}
+
+void OCLProfiler::record(const cl::Event& event, const QString& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_enabled && event() != nullptr && !isFull())
+        m_commands.push_back({ name, std::make_shared<cl::Event>(event), cl::Event() });
+}
+
+void OCLProfiler::recordSpan(const cl::Event& first, const cl::Event& last, const QString& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_enabled && first() != nullptr && last() != nullptr && !isFull())
+        m_commands.push_back({ name, std::make_shared<cl::Event>(first), last });
+}
+
+size_t OCLProfiler::maxCommands() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxCommands;
+}
+
+void OCLProfiler::setMaxCommands(size_t maxCommands)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxCommands = maxCommands;
+}
+
+// total, mean and share of the time per command name, plus the mean delay between queuing and start
+// (spans are not part of the busy time, since they contain other commands)
+void OCLProfiler::summary() const
+{
+    const auto allTimings = timings();
+    if(allTimings.empty())
+    {
+        qInfo() << "OCLProfiler: no profiled commands.";
+        return;
+    }
+
+    struct Entry { QString type; uint count = 0; cl_ulong busy = 0; cl_ulong delay = 0; };
+    std::map<QString, Entry> entries;
+    cl_ulong total = 0;
+    for(const auto& timing : allTimings)
+    {
+        auto& entry = entries[timing.name];
+        entry.type = timing.type;
+        ++entry.count;
+        entry.busy += timing.end - timing.start;
+        entry.delay += timing.start - timing.queued;
+        if(timing.type != QLatin1String("span"))
+            total += timing.end - timing.start;
+    }
+
+    qInfo().noquote() << QString("OCLProfiler: %1 commands, %2 ms busy time")
+                         .arg(allTimings.size()).arg(milliseconds(total), 0, 'f', 3);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_nbDropped > 0)
+            qWarning().noquote() << QString("OCLProfiler: %1 further commands not recorded (limit of %2 commands, "
+                                            "see setMaxCommands())").arg(m_nbDropped).arg(m_maxCommands);
+    }
+    for(const auto& entry : entries)
+        qInfo().noquote() << QString("  %1 (%2): %3x, %4 ms total, %5 ms mean, %6% of busy time, %7 ms mean delay")
+                             .arg(entry.first, entry.second.type).arg(entry.second.count)
+                             .arg(milliseconds(entry.second.busy), 0, 'f', 3)
+                             .arg(milliseconds(entry.second.busy) / entry.second.count, 0, 'f', 3)
+                             .arg(100.0 * entry.second.busy / std::max(total, cl_ulong(1)), 0, 'f', 1)
+                             .arg(milliseconds(entry.second.delay) / entry.second.count, 0, 'f', 3);
+}
+
+// trace event format: complete events ("X") from start to end, times in microseconds relative to the
+// first queued command; queued and submit timestamps as arguments
+bool OCLProfiler::writeChromeTrace(const QString& fileName) const
+{
+    const auto allTimings = timings();
+
+    auto origin = std::numeric_limits<cl_ulong>::max();
+    for(const auto& timing : allTimings)
+        origin = std::min(origin, timing.queued);
+    const auto microseconds = [origin] (cl_ulong ns) { return (ns - origin) * 1.0e-3; };
+
+    std::map<cl_command_queue, int> queueIds;
+    QJsonArray traceEvents;
+    for(const auto& timing : allTimings)
+    {
+        const auto queueId = queueIds.emplace(timing.queue, static_cast<int>(queueIds.size())).first->second;
+
+        QJsonObject args;
+        args.insert("queued us", microseconds(timing.queued));
+        args.insert("submit us", microseconds(timing.submit));
+
+        QJsonObject traceEvent;
+        traceEvent.insert("name", timing.name);
+        traceEvent.insert("cat", timing.type);
+        traceEvent.insert("ph", "X");
+        traceEvent.insert("ts", microseconds(timing.start));
+        traceEvent.insert("dur", (timing.end - timing.start) * 1.0e-3);
+        traceEvent.insert("pid", 0);
+        traceEvent.insert("tid", queueId);
+        traceEvent.insert("args", args);
+        traceEvents.append(traceEvent);
+    }
+
+    std::map<cl_command_queue, QString> deviceNames;
+    for(const auto& timing : allTimings)
+        deviceNames[timing.queue] = timing.device;
+
+    for(const auto& queue : queueIds)
+    {
+        QJsonObject args;
+        args.insert("name", QString("queue %1 (%2)").arg(queue.second).arg(deviceNames[queue.first]));
+        QJsonObject metadata;
+        metadata.insert("name", "thread_name");
+        metadata.insert("ph", "M");
+        metadata.insert("pid", 0);
+        metadata.insert("tid", queue.second);
+        metadata.insert("args", args);
+        traceEvents.append(metadata);
+    }
+
+    QJsonObject trace;
+    trace.insert("traceEvents", traceEvents);
+    trace.insert("displayTimeUnit", "ms");
+
+    QFile file(fileName);
+    const auto json = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+    if(!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+    {
+        qCritical() << "OCLProfiler: could not write" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+void OCLProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.clear();
+    m_nbDropped = 0;
+}
+
+// requires the lock
+bool OCLProfiler::isFull() const
+{
+    if(m_commands.size() < m_maxCommands)
+        return false;
+
+    ++m_nbDropped;
+    return true;
+}
+
+// waits for all recorded commands; commands without profiling information (e.g. enqueued on a
+// queue without CL_QUEUE_PROFILING_ENABLE) are skipped
+std::vector<OCLProfiler::Timing> OCLProfiler::timings() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Timing> ret;
+    for(const auto& command : m_commands)
+    {
+        const auto& event = *command.event;
+        if(event() == nullptr)
+            continue;
+
+        try {
+            const auto isSpan = command.last() != nullptr;
+            const auto& last = isSpan ? command.last : event;
+            last.wait();
+
+            Timing timing;
+            timing.name = command.name;
+            timing.type = isSpan ? QStringLiteral("span")
+                                 : commandType(event.getInfo<CL_EVENT_COMMAND_TYPE>());
+            const auto queue = event.getInfo<CL_EVENT_COMMAND_QUEUE>();
+            timing.queue = queue();
+            timing.device = QString::fromStdString(queue.getInfo<CL_QUEUE_DEVICE>().getInfo<CL_DEVICE_NAME>());
+            timing.queued = event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+            timing.submit = event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+            timing.start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+            timing.end = last.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+            ret.push_back(timing);
+        } catch (const cl::Error&) {
+            continue;
+        }
+    }
+
+    return ret;
+}
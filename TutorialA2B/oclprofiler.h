@@ -0,0 +1,93 @@
+#ifndef OCLPROFILER_H
+#define OCLPROFILER_H
+
+#include "ocl/openclconfig.h"
+
+#include <QString>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// OCLProfiler
+// opt-in timing of the OpenCL commands (writes, kernels, reads, copies) enqueued by the tutorial's
+// filters, based on OpenCL event profiling:
+// -> enable it before creating the filters (setEnabled(true) or environment variable
+//    CTL_OCL_PROFILING=1); the filters create their queues by createQueue(), which adds
+//    CL_QUEUE_PROFILING_ENABLE if profiling is enabled
+// -> commands are recorded by passing event(name) as the event argument of an enqueue call (the
+//    returned handle keeps the event alive until the end of the call, even if clear() is called
+//    concurrently) or by record() for an existing event (no-ops if profiling is disabled)
+// -> recordSpan() records the time between two events of the same queue, e.g. markers around all
+//    commands of a filter call
+// -> at most maxCommands() commands are recorded (each one keeps its event alive); further commands
+//    are counted, but not recorded until clear()
+// -> summary() reports the time per command name through the MessageHandler (qInfo),
+//    writeChromeTrace() writes the queued/submit/start/end timestamps of all commands as a trace
+//    file (chrome://tracing, Perfetto), one row per queue
+// -> only the tutorial's own classes are profiled (their queues are created by createQueue());
+//    the CTL's OCL::RayCasterProjector, OCL::FDKReconstructor and GenericOCLVolumeFilter create
+//    their queues and events internally and do not appear in the profile
+class OCLProfiler
+{
+public:
+    // event argument of an enqueue call (converts to cl::Event*, nullptr if profiling is disabled)
+    class EventHandle
+    {
+    public:
+        operator cl::Event*() const { return m_event.get(); }
+
+    private:
+        friend class OCLProfiler;
+        std::shared_ptr<cl::Event> m_event;
+    };
+
+    static OCLProfiler& instance();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    cl::CommandQueue createQueue(const cl::Context& context, const cl::Device& device) const;
+
+    EventHandle event(const QString& name);
+    void record(const cl::Event& event, const QString& name);
+    void recordSpan(const cl::Event& first, const cl::Event& last, const QString& name);
+
+    size_t maxCommands() const;
+    void setMaxCommands(size_t maxCommands);
+
+    void summary() const;
+    bool writeChromeTrace(const QString& fileName) const;
+    void clear();
+
+private:
+    OCLProfiler();
+
+    struct Command
+    {
+        QString name;
+        std::shared_ptr<cl::Event> event; // shared with the EventHandle of event()
+        cl::Event last; // spans only: end of the span
+    };
+
+    struct Timing
+    {
+        QString name;
+        QString type; // write, kernel, read, copy, ...
+        cl_command_queue queue; // identifies the row in the trace
+        QString device;
+        cl_ulong queued, submit, start, end; // ns
+    };
+
+    std::vector<Timing> timings() const;
+    bool isFull() const; // counts a dropped command if full
+
+    std::deque<Command> m_commands;
+    size_t m_maxCommands = 100000;
+    mutable size_t m_nbDropped = 0;
+    bool m_enabled = false;
+    mutable std::mutex m_mutex;
+};
+
+#endif // OCLPROFILER_H
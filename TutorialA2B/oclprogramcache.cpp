@@ -0,0 +1,275 @@
+#include "oclprogramcache.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <stdexcept>
+
+namespace {
+
+const QString EMBEDDED_PREFIX = QStringLiteral(":/kernels/");
+
+// the file itself if it exists, otherwise the embedded source with the same file name (if any)
+QString resolve(const std::string& clFileName)
+{
+    const auto fileName = QString::fromStdString(clFileName);
+    if(QFileInfo(fileName).isFile())
+        return fileName;
+
+    const auto embedded = EMBEDDED_PREFIX + QFileInfo(fileName).fileName();
+    if(QFileInfo(embedded).isFile())
+        return embedded;
+
+    return QString();
+}
+
+QString hashSource(const std::string& sourceCode)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(QByteArray::fromStdString(sourceCode),
+                                                        QCryptographicHash::Sha256).toHex());
+}
+
+} // unnamed namespace
+
+OCLProgramCache& OCLProgramCache::instance()
+{
+    static OCLProgramCache instance;
+    return instance;
+}
+
+OCLProgramCache::OCLProgramCache()
+    : m_cacheDirectory(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                       + "/ctl-tutorials/opencl")
+{
+}
+
+void OCLProgramCache::addKernel(const std::string& kernelName, const std::string& sourceCode,
+                                const std::string& programName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto& program = m_programs[programName];
+    if(program.sourceCode != sourceCode) // new or changed program -> (re-)build on first use
+        program = { sourceCode, hashSource(sourceCode), cl::Program(), {} };
+
+    program.kernels.emplace(kernelName, cl::Kernel());
+}
+
+// builds the program on first use; throws cl::Error
+cl::Kernel OCLProgramCache::kernel(const std::string& kernelName, const std::string& programName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto program = m_programs.find(programName);
+    if(program == m_programs.end())
+        return cl::Kernel();
+
+    const auto kernel = program->second.kernels.find(kernelName);
+    if(kernel == program->second.kernels.end())
+        return cl::Kernel();
+
+    if(kernel->second() == nullptr)
+    {
+        if(program->second.program() == nullptr)
+            build(program->second);
+        kernel->second = cl::Kernel(program->second.program, kernelName.c_str());
+    }
+
+    return kernel->second;
+}
+
+QString OCLProgramCache::sourceHash(const cl::Program& program) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(const auto& entry : m_programs)
+            if(entry.second.program() == program())
+                return entry.second.sourceHash;
+    }
+
+    return hashSource(program.getInfo<CL_PROGRAM_SOURCE>());
+}
+
+// null program if 'programName' is unknown; throws cl::Error
+cl::Program OCLProgramCache::program(const std::string& programName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto program = m_programs.find(programName);
+    if(program == m_programs.end())
+        return cl::Program();
+
+    if(program->second.program() == nullptr)
+        build(program->second);
+
+    return program->second.program;
+}
+
+QString OCLProgramCache::cacheDirectory() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cacheDirectory;
+}
+
+void OCLProgramCache::setCacheDirectory(const QString& directory)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cacheDirectory = directory;
+}
+
+std::string OCLProgramCache::loadSourceCode(const std::string& clFileName)
+{
+    QFile file(resolve(clFileName));
+    if(file.fileName().isEmpty() || !file.open(QIODevice::ReadOnly))
+        throw std::runtime_error(clFileName + "\nis not readable.");
+
+    return file.readAll().toStdString();
+}
+
+// embedded sources are extracted to the cache directory (only rewritten if they changed)
+std::string OCLProgramCache::clFilePath(const std::string& clFileName)
+{
+    const auto fileName = resolve(clFileName);
+    if(fileName.isEmpty())
+        throw std::runtime_error(clFileName + "\nis not readable.");
+    if(!fileName.startsWith(EMBEDDED_PREFIX))
+        return clFileName;
+
+    const auto sourceCode = loadSourceCode(clFileName);
+    const auto directory = instance().cacheDirectory().isEmpty() ? QDir::tempPath() + "/ctl-tutorials/opencl"
+                                                                 : instance().cacheDirectory();
+    const auto path = directory + "/sources/" + QFileInfo(fileName).fileName();
+
+    QFile extracted(path);
+    if(extracted.open(QIODevice::ReadOnly) && extracted.readAll().toStdString() == sourceCode)
+        return path.toStdString();
+    extracted.close();
+
+    QSaveFile file(path);
+    if(!QDir().mkpath(directory + "/sources") || !file.open(QIODevice::WriteOnly)
+            || file.write(sourceCode.data(), sourceCode.size()) != qint64(sourceCode.size()) || !file.commit())
+        throw std::runtime_error("Could not extract " + clFileName + " to " + path.toStdString());
+
+    return path.toStdString();
+}
+
+// from the cached binaries if available for all devices, otherwise from source (then cached)
+void OCLProgramCache::build(Program& program) const
+{
+    const auto devices = CTL::OCL::OpenCLConfig::instance().devices();
+
+    program.program = loadBinaries(program.sourceCode);
+    if(program.program() != nullptr)
+    {
+        try {
+            program.program.build(devices);
+            return;
+        } catch (const cl::Error&) {
+            qWarning() << "OCLProgramCache: cached program binary rejected, compiling from source.";
+        }
+    }
+
+    program.program = cl::Program(CTL::OCL::OpenCLConfig::instance().context(), program.sourceCode);
+    try {
+        program.program.build(devices);
+    } catch (const cl::Error&) {
+        for(const auto& device : devices)
+            qCritical() << "OpenCL build log:"
+                        << QString::fromStdString(program.program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
+        program.program = cl::Program();
+        throw;
+    }
+
+    storeBinaries(program.program, program.sourceCode);
+}
+
+// null program if the cache is disabled or a binary is missing
+cl::Program OCLProgramCache::loadBinaries(const std::string& sourceCode) const
+{
+    if(m_cacheDirectory.isEmpty())
+        return cl::Program();
+
+    const auto& oclConfig = CTL::OCL::OpenCLConfig::instance();
+    const auto devices = oclConfig.devices();
+
+    std::vector<QByteArray> binaries;
+    std::vector<cl_device_id> deviceIds;
+    for(const auto& device : devices)
+    {
+        QFile file(cacheFile(device, sourceCode));
+        if(!file.open(QIODevice::ReadOnly))
+            return cl::Program();
+        binaries.push_back(file.readAll());
+        deviceIds.push_back(device());
+    }
+
+    std::vector<size_t> lengths;
+    std::vector<const unsigned char*> data;
+    for(const auto& binary : binaries)
+    {
+        lengths.push_back(static_cast<size_t>(binary.size()));
+        data.push_back(reinterpret_cast<const unsigned char*>(binary.constData()));
+    }
+
+    // C API: the signature of the cl::Program constructor differs between the C++ bindings
+    std::vector<cl_int> status(devices.size());
+    cl_int err;
+    const auto program = clCreateProgramWithBinary(oclConfig.context()(), static_cast<cl_uint>(devices.size()),
+                                                   deviceIds.data(), lengths.data(), data.data(), status.data(),
+                                                   &err);
+    if(err != CL_SUCCESS)
+        return cl::Program();
+
+    return cl::Program(program); // takes ownership
+}
+
+void OCLProgramCache::storeBinaries(const cl::Program& program, const std::string& sourceCode) const
+{
+    if(m_cacheDirectory.isEmpty() || !QDir().mkpath(m_cacheDirectory))
+        return;
+
+    // binaries are in the order of the program's devices
+    const auto devices = program.getInfo<CL_PROGRAM_DEVICES>();
+    std::vector<size_t> sizes(devices.size());
+    if(clGetProgramInfo(program(), CL_PROGRAM_BINARY_SIZES, sizes.size() * sizeof(size_t), sizes.data(),
+                        nullptr) != CL_SUCCESS)
+        return;
+
+    std::vector<std::vector<unsigned char>> binaries(devices.size());
+    std::vector<unsigned char*> data(devices.size());
+    for(size_t dev = 0; dev < devices.size(); ++dev)
+    {
+        binaries[dev].resize(sizes[dev]);
+        data[dev] = binaries[dev].data();
+    }
+    if(clGetProgramInfo(program(), CL_PROGRAM_BINARIES, data.size() * sizeof(unsigned char*), data.data(),
+                        nullptr) != CL_SUCCESS)
+        return;
+
+    // QSaveFile: concurrent processes never see partially written binaries
+    for(size_t dev = 0; dev < devices.size(); ++dev)
+    {
+        QSaveFile file(cacheFile(devices[dev], sourceCode));
+        if(binaries[dev].empty() || !file.open(QIODevice::WriteOnly))
+            continue;
+        file.write(reinterpret_cast<const char*>(binaries[dev].data()), binaries[dev].size());
+        if(!file.commit())
+            qWarning() << "OCLProgramCache: could not write" << file.fileName();
+    }
+}
+
+QString OCLProgramCache::cacheFile(const cl::Device& device, const std::string& sourceCode) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArray::fromStdString(device.getInfo<CL_DEVICE_NAME>()));
+    hash.addData(QByteArray::fromStdString(device.getInfo<CL_DEVICE_VERSION>()));
+    hash.addData(QByteArray::fromStdString(device.getInfo<CL_DRIVER_VERSION>()));
+    hash.addData(QByteArray::fromStdString(sourceCode));
+
+    return m_cacheDirectory + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+}
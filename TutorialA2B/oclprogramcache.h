@@ -0,0 +1,64 @@
+#ifndef OCLPROGRAMCACHE_H
+#define OCLPROGRAMCACHE_H
+
+#include "ocl/openclconfig.h"
+
+#include <QString>
+
+#include <map>
+#include <mutex>
+
+// OCLProgramCache
+// builds the OpenCL programs of the tutorial's filters (same usage as OpenCLConfig::addKernel() and
+// OpenCLConfig::kernel(), except that kernel() returns the reference-counted cl::Kernel by value,
+// which stays valid if the program is replaced by addKernel()), but keeps the compiled program
+// binaries on disk:
+// -> a cache entry is keyed by device, driver version and a hash of the source code
+// -> subsequent processes load the binary instead of compiling the source (falls back to the
+//    source if the binary is rejected, e.g. after a driver update)
+// -> an empty cache directory disables the on-disk cache
+// kernel sources can be embedded into the executable (kernels.qrc, prefix '/kernels'):
+// -> loadSourceCode() and clFilePath() use the file on disk if it exists, otherwise the embedded
+//    source with the same file name, i.e. a bare file name such as "movingaveragefilter.cl"
+//    refers to the embedded kernel
+class OCLProgramCache
+{
+public:
+    static OCLProgramCache& instance();
+
+    void addKernel(const std::string& kernelName, const std::string& sourceCode, const std::string& programName);
+    // null kernel if unknown; the returned object shares the cl_kernel (and its arguments) with the cache
+    cl::Kernel kernel(const std::string& kernelName, const std::string& programName);
+    cl::Program program(const std::string& programName); // e.g. for separate kernel objects per thread
+    // hash of the source code of 'program' (for programs of this cache and programs built from source)
+    QString sourceHash(const cl::Program& program) const;
+
+    QString cacheDirectory() const;
+    void setCacheDirectory(const QString& directory);
+
+    // throw std::runtime_error if neither the file nor an embedded source exists
+    static std::string loadSourceCode(const std::string& clFileName);
+    static std::string clFilePath(const std::string& clFileName); // for filters that read the file themselves
+
+private:
+    OCLProgramCache();
+
+    struct Program
+    {
+        std::string sourceCode;
+        QString sourceHash;
+        cl::Program program;
+        std::map<std::string, cl::Kernel> kernels;
+    };
+
+    void build(Program& program) const;
+    cl::Program loadBinaries(const std::string& sourceCode) const;
+    void storeBinaries(const cl::Program& program, const std::string& sourceCode) const;
+    QString cacheFile(const cl::Device& device, const std::string& sourceCode) const;
+
+    std::map<std::string, Program> m_programs;
+    QString m_cacheDirectory;
+    mutable std::mutex m_mutex;
+};
+
+#endif // OCLPROGRAMCACHE_H
@@ -0,0 +1,8 @@
+// placeholder kernel for GenericOCLVolumeFilter subclasses that launch their own kernels from the
+// OCLProgramCache (see VolumeSegmentationFilter): GenericOCLVolumeFilter builds this one from source
+// instead of the actual filter kernel
+kernel void filter( read_only image3d_t oldVol,
+                    global float* newVol,
+                    uint z)
+{
+}
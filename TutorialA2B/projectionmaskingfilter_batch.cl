@@ -0,0 +1,42 @@
+// batched version of projectionmaskingfilter.cl (see BatchedOCLProjectionFilter):
+// one launch for a block of views, global id 2 is the module index within the block
+kernel void filter_batch( global const float* oldProj,
+                          global float* newProj,
+                          uint firstView,
+                          uint nbModules,
+                          float rectTopLeftX,
+                          float rectTopLeftY,
+                          float rectBottomRightX,
+                          float rectBottomRightY)
+{
+    // get IDs
+    const int u = get_global_id(0);
+    const int v = get_global_id(1);
+    const size_t pix = u + get_global_size(0) * (v + get_global_size(1) * get_global_id(2));
+
+    // set pixels outside the rect to 0.0
+    if(u < rectTopLeftX || u > rectBottomRightX || v < rectTopLeftY || v > rectBottomRightY)
+        newProj[pix] = 0.0f;
+    else
+        newProj[pix] = oldProj[pix];
+}
+
+// same with data transferred in half precision (arithmetic in float, no cl_khr_fp16 required)
+kernel void filter_batch_half( global const half* oldProj,
+                               global half* newProj,
+                               uint firstView,
+                               uint nbModules,
+                               float rectTopLeftX,
+                               float rectTopLeftY,
+                               float rectBottomRightX,
+                               float rectBottomRightY)
+{
+    const int u = get_global_id(0);
+    const int v = get_global_id(1);
+    const size_t pix = u + get_global_size(0) * (v + get_global_size(1) * get_global_id(2));
+
+    if(u < rectTopLeftX || u > rectBottomRightX || v < rectTopLeftY || v > rectBottomRightY)
+        vstore_half(0.0f, pix, newProj);
+    else
+        vstore_half(vload_half(pix, oldProj), pix, newProj);
+}
@@ -0,0 +1,18 @@
+// sets all pixels outside of the rectangle [left, right] x [top, bottom] to zero;
+// 'proj' holds all modules of all views one after another (see DeviceProjectionData),
+// global id 2 is the index of the module (view * nbModules + module)
+kernel void mask_rect( global float* proj,
+                       int left,
+                       int top,
+                       int right,
+                       int bottom)
+{
+    const int u = get_global_id(0);
+    const int v = get_global_id(1);
+
+    if(u >= left && u <= right && v >= top && v <= bottom)
+        return;
+
+    const size_t pix = u + get_global_size(0) * (v + get_global_size(1) * get_global_id(2));
+    proj[pix] = 0.0f;
+}
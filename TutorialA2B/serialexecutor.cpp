@@ -0,0 +1,42 @@
+#include "serialexecutor.h"
+
+SerialExecutor::SerialExecutor()
+    : m_thread(&SerialExecutor::workerLoop, this)
+{
+}
+
+SerialExecutor::~SerialExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_taskAvailable.notify_one();
+
+    m_thread.join();
+}
+
+SerialExecutor& SerialExecutor::instance()
+{
+    static SerialExecutor instance;
+    return instance;
+}
+
+void SerialExecutor::workerLoop()
+{
+    for(;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if(m_tasks.empty()) // stopped and nothing left to do
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task(); // exceptions end up in the task's future
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SERIALEXECUTOR_H
+#define SERIALEXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// SerialExecutor
+// single worker thread that executes submitted tasks one after another in submission order
+// (e.g. calls of OpenCL filters, which must not run concurrently on the same filter/queue);
+// the destructor finishes all pending tasks
+class SerialExecutor
+{
+public:
+    SerialExecutor();
+    ~SerialExecutor();
+
+    SerialExecutor(const SerialExecutor&) = delete;
+    SerialExecutor& operator=(const SerialExecutor&) = delete;
+
+    // the future provides the result of 'task' (or rethrows its exception)
+    template<typename Function>
+    std::future<typename std::result_of<Function()>::type> submit(Function task);
+
+    static SerialExecutor& instance();
+
+private:
+    void workerLoop();
+
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    bool m_stop = false;
+    std::thread m_thread; // last member: started after all others are initialized
+};
+
+template<typename Function>
+std::future<typename std::result_of<Function()>::type> SerialExecutor::submit(Function task)
+{
+    using Result = typename std::result_of<Function()>::type;
+
+    // std::function requires a copyable callable
+    auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    auto ret = packagedTask->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back([packagedTask] { (*packagedTask)(); });
+    }
+    m_taskAvailable.notify_one();
+
+    return ret;
+}
+
+#endif // SERIALEXECUTOR_H
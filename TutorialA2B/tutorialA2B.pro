@@ -9,10 +9,25 @@ include(../../ctl/modules/ctl.pri)
 include(../../ctl/modules/ctl_ocl.pri)
 include(../../ctl/modules/ctl_qtgui.pri)
 
+# 16 bit floating-point types (Half)
+INCLUDEPATH += ../TutorialA3
+
 SOURCES += \
+        asyncfilter.cpp \
+        batchdatamodel.cpp \
+        compileddatamodel.cpp \
+        customoclprojectionfilters.cpp \
         customoclvolumefilters.cpp \
         customvolumefilters.cpp \
-        main.cpp
+        deviceprojectiondata.cpp \
+        main.cpp \
+        oclprofiler.cpp \
+        oclprogramcache.cpp \
+        serialexecutor.cpp \
+        workgrouptuner.cpp
+
+# kernel sources embedded into the executable (see oclprogramcache.h)
+RESOURCES += kernels.qrc
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -20,10 +35,24 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    ../TutorialA3/halfprecision.h \
+    asyncfilter.h \
+    batchdatamodel.h \
+    compileddatamodel.h \
+    customoclprojectionfilters.h \
     customoclvolumefilters.h \
-    customvolumefilters.h
+    customvolumefilters.h \
+    deviceprojectiondata.h \
+    oclprofiler.h \
+    oclprogramcache.h \
+    serialexecutor.h \
+    workgrouptuner.h
 
 DISTFILES += \
+    movingaveragefilter.cl \
+    placeholdervolumefilter.cl \
     projectionmaskingfilter.cl \
+    projectionmaskingfilter_batch.cl \
+    projectionmaskingfilter_device.cl \
     volumesegementationfilter_flexible.cl \
     volumesegmentationfilter.cl
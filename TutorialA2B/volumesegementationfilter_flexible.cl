@@ -1,21 +1,43 @@
+// up to this number of thresholds, all thresholds are compared (cheaper than a search)
+#define LINEAR_SEARCH_MAX 8
+
+// number of thresholds smaller than 'value' (= index of the segment);
+// lower bound search with the same number of iterations for all voxels (log2(n)),
+// the comparisons only select the next position -> no divergence within a work-group
+uint count_below(global const float* thresholds, uint n, float value)
+{
+    uint base = 0;
+    while(n > 1)
+    {
+        const uint half = n / 2;
+        base = (thresholds[base + half] < value) ? base + half : base;
+        n -= half;
+    }
+    return base + (thresholds[base] < value);
+}
+
 // filter kernel - with three additional arguments
+// -> 'sorted' != 0 if the thresholds are in ascending order (required for the search)
 kernel void filter( read_only image3d_t oldVol,
                     global float* newVol,
                     uint z,
-                    global float* thresholds,
-                    uint numThresholds)
+                    global const float* thresholds,
+                    uint numThresholds,
+                    uint sorted)
 {
     // get IDs
     const int x = get_global_id(0);
     const int y = get_global_id(1);
     const int4 vox = (int4)(x, y, z, 0);
 
-    // categorize voxel
+    // categorize voxel: index of the last threshold below the value (+1)
     const float refVal = read_imagef(oldVol, vox).x;
-    float newVal = 0.0;
-    for(uint thr = 0; thr < numThresholds; ++thr)
-        if(refVal > thresholds[thr])
-            newVal = (float) (thr+1);
+    float newVal = 0.0f;
+    if(sorted && numThresholds > LINEAR_SEARCH_MAX)
+        newVal = (float) count_below(thresholds, numThresholds, refVal);
+    else
+        for(uint thr = 0; thr < numThresholds; ++thr)
+            newVal = (refVal > thresholds[thr]) ? (float) (thr+1) : newVal;
 
     //void write_bufferf(global float* buffer, int4 coord, float color, image3d_t image)
     write_bufferf(newVol, vox, newVal, oldVol);
@@ -0,0 +1,259 @@
+#include "workgrouptuner.h"
+#include "oclprogramcache.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+const uint NB_TIMED_RUNS = 2;
+
+cl::NDRange toNDRange(const std::vector<size_t>& localSize)
+{
+    switch(localSize.size())
+    {
+    case 1: return cl::NDRange(localSize[0]);
+    case 2: return cl::NDRange(localSize[0], localSize[1]);
+    case 3: return cl::NDRange(localSize[0], localSize[1], localSize[2]);
+    default: return cl::NullRange;
+    }
+}
+
+QString entryKey(const std::string& kernelName, const QString& sourceHash, const cl::Device& device,
+                 const cl::NDRange& globalSize, uint nbTunedDims)
+{
+    QStringList size;
+    for(size_t dim = 0; dim < std::min(globalSize.dimensions(), size_t(nbTunedDims)); ++dim)
+        size.append(QString::number(globalSize[dim]));
+
+    return QString::fromStdString(device.getInfo<CL_DEVICE_NAME>()) + " | "
+         + QString::fromStdString(device.getInfo<CL_DRIVER_VERSION>()) + " | "
+         + QString::fromStdString(kernelName) + " | " + sourceHash + " | " + size.join('x');
+}
+
+// false if the local size exceeds the limits of the kernel on the device
+bool isValid(const std::vector<size_t>& localSize, const cl::Kernel& kernel, const cl::Device& device)
+{
+    const auto maxSizes = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+    for(size_t dim = 0; dim < localSize.size(); ++dim)
+        if(dim >= maxSizes.size() || localSize[dim] > maxSizes[dim])
+            return false;
+
+    return std::accumulate(localSize.cbegin(), localSize.cend(), size_t(1), std::multiplies<size_t>())
+            <= kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+}
+
+// power-of-two local sizes that divide the global size (1 in the dimensions that are not tuned):
+// -> one tuned dimension: at least 16 work items (or the maximum work-group size, if smaller)
+// -> more tuned dimensions: at least a quarter of the maximum work-group size, with non-increasing
+//    extents (the first dimension is the contiguous one)
+std::vector<std::vector<size_t>> candidates(const cl::Kernel& kernel, const cl::Device& device,
+                                            const cl::NDRange& globalSize, uint nbTunedDims)
+{
+    const auto maxItems = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    const auto maxSizes = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+    const auto nbTuned = std::min(globalSize.dimensions(), size_t(nbTunedDims));
+
+    auto minItems = std::min(maxItems, size_t(16));
+    if(nbTuned > 1)
+    {
+        size_t maxPowerOfTwo = 1;
+        while(2 * maxPowerOfTwo <= maxItems)
+            maxPowerOfTwo *= 2;
+        minItems = std::max(minItems, maxPowerOfTwo / 4);
+    }
+
+    std::vector<std::vector<size_t>> ret{ {} }; // the driver's choice
+    std::vector<std::vector<size_t>> partial{ {} };
+    for(size_t dim = 0; dim < globalSize.dimensions(); ++dim)
+    {
+        const auto maxSize = dim < nbTuned ? std::min(maxSizes[dim], globalSize[dim]) : size_t(1);
+
+        std::vector<std::vector<size_t>> extended;
+        for(const auto& prefix : partial)
+            for(size_t s = 1; s <= maxSize; s *= 2)
+            {
+                if(globalSize[dim] % s != 0 || (dim > 0 && dim < nbTuned && s > prefix.back()))
+                    continue;
+                auto candidate = prefix;
+                candidate.push_back(s);
+                const auto nbItems = std::accumulate(candidate.cbegin(), candidate.cend(), size_t(1),
+                                                     std::multiplies<size_t>());
+                if(nbItems <= maxItems)
+                    extended.push_back(std::move(candidate));
+            }
+        partial.swap(extended);
+    }
+
+    for(auto& candidate : partial)
+        if(std::accumulate(candidate.cbegin(), candidate.cend(), size_t(1), std::multiplies<size_t>()) >= minItems)
+            ret.push_back(std::move(candidate));
+
+    return ret;
+}
+
+} // unnamed namespace
+
+WorkGroupTuner& WorkGroupTuner::instance()
+{
+    static WorkGroupTuner instance;
+    return instance;
+}
+
+WorkGroupTuner::WorkGroupTuner()
+{
+    const auto cacheDirectory = OCLProgramCache::instance().cacheDirectory();
+    if(!cacheDirectory.isEmpty())
+        m_fileName = cacheDirectory + "/workgroupsizes.json";
+}
+
+// tuning is serialized (concurrent launches would distort the timings)
+cl::NDRange WorkGroupTuner::localSize(const std::string& kernelName, const cl::Kernel& kernel,
+                                      const cl::CommandQueue& queue, const cl::NDRange& globalSize,
+                                      const std::function<void(const cl::NDRange&)>& launch, uint nbTunedDims)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_loaded)
+        load();
+
+    const auto device = queue.getInfo<CL_QUEUE_DEVICE>();
+    const auto sourceHash = OCLProgramCache::instance().sourceHash(kernel.getInfo<CL_KERNEL_PROGRAM>());
+    const auto key = entryKey(kernelName, sourceHash, device, globalSize, nbTunedDims);
+    const auto stored = m_localSizes.find(key);
+    if(stored != m_localSizes.end())
+    {
+        if(isValid(stored->second, kernel, device))
+            return toNDRange(stored->second);
+        qWarning() << "WorkGroupTuner: stored local size of" << QString::fromStdString(kernelName)
+                   << "exceeds the kernel's work-group size limit.";
+    }
+    if(!m_enabled)
+        return cl::NullRange;
+
+    const auto best = tune(kernel, queue, globalSize, launch, nbTunedDims);
+    m_localSizes[key] = best;
+    save();
+
+    return toNDRange(best);
+}
+
+bool WorkGroupTuner::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void WorkGroupTuner::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+QString WorkGroupTuner::fileName() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fileName;
+}
+
+void WorkGroupTuner::setFileName(const QString& fileName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fileName = fileName;
+    m_localSizes.clear();
+    m_loaded = false;
+}
+
+// minimum time of NB_TIMED_RUNS launches (after a warm-up launch) for each candidate;
+// candidates rejected by the runtime (e.g. too many resources) are skipped
+WorkGroupTuner::LocalSize WorkGroupTuner::tune(const cl::Kernel& kernel, const cl::CommandQueue& queue,
+                                               const cl::NDRange& globalSize,
+                                               const std::function<void(const cl::NDRange&)>& launch,
+                                               uint nbTunedDims) const
+{
+    const auto device = queue.getInfo<CL_QUEUE_DEVICE>();
+    queue.finish();
+
+    LocalSize best;
+    auto bestSeconds = std::numeric_limits<double>::max();
+    for(const auto& candidate : candidates(kernel, device, globalSize, nbTunedDims))
+    {
+        try {
+            launch(toNDRange(candidate));
+            queue.finish();
+
+            for(uint run = 0; run < NB_TIMED_RUNS; ++run)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                launch(toNDRange(candidate));
+                queue.finish();
+                const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                if(seconds < bestSeconds)
+                {
+                    bestSeconds = seconds;
+                    best = candidate;
+                }
+            }
+        } catch (const cl::Error&) {
+            continue;
+        }
+    }
+
+    return best;
+}
+
+void WorkGroupTuner::load()
+{
+    m_loaded = true;
+
+    QFile file(m_fileName);
+    if(m_fileName.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return;
+
+    const auto entries = QJsonDocument::fromJson(file.readAll()).object();
+    for(auto entry = entries.constBegin(); entry != entries.constEnd(); ++entry)
+    {
+        LocalSize localSize;
+        for(const auto& size : entry.value().toArray())
+            localSize.push_back(static_cast<size_t>(size.toDouble()));
+        m_localSizes[entry.key()] = localSize;
+    }
+}
+
+// merged with the file's current content (other processes may have tuned other kernels meanwhile)
+void WorkGroupTuner::save() const
+{
+    if(m_fileName.isEmpty() || !QDir().mkpath(QFileInfo(m_fileName).absolutePath()))
+        return;
+
+    QJsonObject entries;
+    QFile current(m_fileName);
+    if(current.open(QIODevice::ReadOnly))
+        entries = QJsonDocument::fromJson(current.readAll()).object();
+    current.close();
+
+    for(const auto& entry : m_localSizes)
+    {
+        QJsonArray localSize;
+        for(const auto size : entry.second)
+            localSize.append(static_cast<double>(size));
+        entries.insert(entry.first, localSize);
+    }
+
+    QSaveFile file(m_fileName);
+    if(!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(entries).toJson()) < 0 || !file.commit())
+        qWarning() << "WorkGroupTuner: could not write" << m_fileName;
+}
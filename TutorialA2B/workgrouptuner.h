@@ -0,0 +1,64 @@
+#ifndef WORKGROUPTUNER_H
+#define WORKGROUPTUNER_H
+
+#include "ocl/openclconfig.h"
+
+#include <QString>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// WorkGroupTuner
+// chooses the local size (work-group size) of kernel launches by measurement instead of leaving it
+// to the driver (cl::NullRange):
+// -> on first use of a kernel with a global size on a device, power-of-two local sizes that divide
+//    the global size (and the driver's choice) are timed, the fastest one is kept; in more than one
+//    dimension, only shapes with a quarter up to all of the maximum number of work items and
+//    non-increasing extents (e.g. 64x2, 16x8) are tried
+// -> 'nbTunedDims' restricts the tuning to the first dimensions (local size 1 in the others), e.g. if
+//    the global size varies between launches in the last dimension
+// -> the results are stored in a JSON file (keyed by device, driver version, kernel, a hash of the
+//    program source (see OCLProgramCache::sourceHash()) and the global size in the tuned dimensions)
+//    and used on later runs without tuning again; an empty file name disables the file
+// -> stored local sizes that exceed the kernel's limits (CL_KERNEL_WORK_GROUP_SIZE, e.g. after a
+//    change of the kernel's resource usage) are tuned again (or replaced by cl::NullRange if disabled)
+// -> the kernel must be ready to launch (all arguments set); 'launch' enqueues it once with the
+//    given local size (the tuning launches are repeated, i.e. the kernel must be idempotent)
+// used by all kernels of the tutorial's filters that run on the OCLProgramCache, except for the
+// tiled moving average (its local size is the tile size); kernels built internally by the CTL's
+// GenericOCL filters are not covered
+class WorkGroupTuner
+{
+public:
+    static WorkGroupTuner& instance();
+
+    cl::NDRange localSize(const std::string& kernelName, const cl::Kernel& kernel, const cl::CommandQueue& queue,
+                          const cl::NDRange& globalSize,
+                          const std::function<void(const cl::NDRange& localSize)>& launch,
+                          uint nbTunedDims = 3);
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled); // disabled: stored results are used, but no tuning
+    QString fileName() const;
+    void setFileName(const QString& fileName);
+
+private:
+    WorkGroupTuner();
+
+    using LocalSize = std::vector<size_t>; // empty: cl::NullRange
+
+    LocalSize tune(const cl::Kernel& kernel, const cl::CommandQueue& queue, const cl::NDRange& globalSize,
+                   const std::function<void(const cl::NDRange&)>& launch, uint nbTunedDims) const;
+    void load();
+    void save() const;
+
+    std::map<QString, LocalSize> m_localSizes;
+    QString m_fileName;
+    bool m_enabled = true;
+    bool m_loaded = false;
+    mutable std::mutex m_mutex;
+};
+
+#endif // WORKGROUPTUNER_H
@@ -0,0 +1,297 @@
+#ifndef HALFPRECISION_H
+#define HALFPRECISION_H
+
+#include "img/projectiondata.h"
+#include "img/voxelvolume.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// 16 bit floating-point storage types:
+// -> Half: IEEE 754 binary16 (10 bit mantissa, range up to 65504)
+// -> BFloat16: upper half of a float (7 bit mantissa, same range as float)
+// both convert to float implicitly, i.e. all arithmetic is done in fp32 (conversion back with
+// round to nearest even by the explicit constructor); this way, they can be used as RawType of
+// RawDataIO and with metric::RMSE
+class Half
+{
+public:
+    Half() = default;
+    explicit Half(float value) : m_bits(fromFloat(value)) {}
+
+    operator float() const { return toFloat(m_bits); }
+
+    uint16_t bits() const { return m_bits; }
+    static Half fromBits(uint16_t bits) { Half ret; ret.m_bits = bits; return ret; }
+
+private:
+    static uint16_t fromFloat(float value);
+    static float toFloat(uint16_t bits);
+
+    uint16_t m_bits = 0;
+};
+
+class BFloat16
+{
+public:
+    BFloat16() = default;
+    explicit BFloat16(float value) : m_bits(fromFloat(value)) {}
+
+    operator float() const { return toFloat(m_bits); }
+
+    uint16_t bits() const { return m_bits; }
+    static BFloat16 fromBits(uint16_t bits) { BFloat16 ret; ret.m_bits = bits; return ret; }
+
+private:
+    static uint16_t fromFloat(float value);
+    static float toFloat(uint16_t bits);
+
+    uint16_t m_bits = 0;
+};
+
+// HalfProjectionData / HalfVolume
+// 16 bit storage variants of ProjectionData and VoxelVolume<float> (half the memory and IO);
+// processing is done on fp32 copies of the data (or of parts of it), e.g. for point-wise filters:
+//   auto slab = halfVolume.slab(z, 16); filter.filter(slab); halfVolume.setSlab(slab, z);
+template <typename T16 = Half>
+class HalfProjectionData
+{
+public:
+    explicit HalfProjectionData(const CTL::ProjectionData& projections);
+
+    const CTL::ProjectionData::Dimensions& dimensions() const { return m_dims; }
+    const std::vector<T16>& data() const { return m_data; }
+    std::vector<T16>& data() { return m_data; }
+
+    CTL::ProjectionData toProjectionData() const;
+    CTL::SingleViewData view(uint viewNb) const;
+    void setView(const CTL::SingleViewData& view, uint viewNb);
+
+private:
+    size_t viewSize() const { return size_t(m_dims.nbChannels) * m_dims.nbRows * m_dims.nbModules; }
+
+    CTL::ProjectionData::Dimensions m_dims;
+    std::vector<T16> m_data;
+};
+
+template <typename T16 = Half>
+class HalfVolume
+{
+public:
+    explicit HalfVolume(const CTL::VoxelVolume<float>& volume);
+
+    const CTL::VoxelVolume<float>::Dimensions& dimensions() const { return m_dims; }
+    const CTL::VoxelVolume<float>::VoxelSize& voxelSize() const { return m_voxelSize; }
+    const std::vector<T16>& data() const { return m_data; }
+    std::vector<T16>& data() { return m_data; }
+
+    CTL::VoxelVolume<float> toVoxelVolume() const;
+    CTL::VoxelVolume<float> slab(uint firstSlice, uint nbSlices) const;
+    void setSlab(const CTL::VoxelVolume<float>& slab, uint firstSlice);
+
+private:
+    size_t sliceSize() const { return size_t(m_dims.x) * m_dims.y; }
+
+    CTL::VoxelVolume<float>::Dimensions m_dims;
+    CTL::VoxelVolume<float>::VoxelSize m_voxelSize;
+    CTL::VoxelVolume<float>::Offset m_offset;
+    std::vector<T16> m_data;
+};
+
+// element-wise conversion from/to fp32
+template <typename T16>
+void toHalfPrecision(const float* src, T16* dst, size_t n)
+{
+    std::transform(src, src + n, dst, [] (float value) { return T16(value); });
+}
+
+template <typename T16>
+void toSinglePrecision(const T16* src, float* dst, size_t n)
+{
+    std::transform(src, src + n, dst, [] (T16 value) { return static_cast<float>(value); });
+}
+
+
+// round to nearest even; overflow -> inf, NaN stays NaN
+inline uint16_t Half::fromFloat(float value)
+{
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+
+    const auto sign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+    const auto absX = x & 0x7FFFFFFFu;
+
+    if(absX >= 0x7F800000u) // inf, NaN
+        return sign | 0x7C00u | (absX > 0x7F800000u ? 0x0200u : 0u);
+    if(absX >= 0x477FF000u) // >= 65520: rounds to inf
+        return sign | 0x7C00u;
+    if(absX < 0x33000000u) // <= 2^-25: rounds to zero
+        return sign;
+
+    uint32_t mant, shift;
+    if(absX < 0x38800000u) // subnormal (< 2^-14)
+    {
+        mant = (absX & 0x007FFFFFu) | 0x00800000u;
+        shift = 126u - (absX >> 23);
+    }
+    else // normal: rebias the exponent (127 -> 15)
+    {
+        mant = absX - 0x38000000u;
+        shift = 13u;
+    }
+
+    auto ret = mant >> shift;
+    const auto rest = mant & ((1u << shift) - 1u);
+    const auto halfway = 1u << (shift - 1u);
+    if(rest > halfway || (rest == halfway && (ret & 1u)))
+        ++ret; // carry into the exponent is intended
+
+    return sign | static_cast<uint16_t>(ret);
+}
+
+inline float Half::toFloat(uint16_t bits)
+{
+    const auto sign = uint32_t(bits & 0x8000u) << 16;
+    auto exp = uint32_t(bits >> 10) & 0x1Fu;
+    auto mant = uint32_t(bits) & 0x03FFu;
+
+    uint32_t x;
+    if(exp == 0x1Fu) // inf, NaN
+        x = sign | 0x7F800000u | (mant << 13);
+    else if(exp != 0u)
+        x = sign | ((exp + 112u) << 23) | (mant << 13);
+    else if(mant == 0u)
+        x = sign;
+    else // subnormal -> normalize
+    {
+        exp = 113u;
+        while(!(mant & 0x0400u))
+        {
+            mant <<= 1;
+            --exp;
+        }
+        x = sign | (exp << 23) | ((mant & 0x03FFu) << 13);
+    }
+
+    float ret;
+    std::memcpy(&ret, &x, sizeof(ret));
+    return ret;
+}
+
+// round to nearest even; NaN stays NaN
+inline uint16_t BFloat16::fromFloat(float value)
+{
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+
+    if((x & 0x7FFFFFFFu) > 0x7F800000u)
+        return static_cast<uint16_t>((x >> 16) | 0x0040u);
+
+    x += 0x7FFFu + ((x >> 16) & 1u);
+    return static_cast<uint16_t>(x >> 16);
+}
+
+inline float BFloat16::toFloat(uint16_t bits)
+{
+    const auto x = uint32_t(bits) << 16;
+
+    float ret;
+    std::memcpy(&ret, &x, sizeof(ret));
+    return ret;
+}
+
+
+template <typename T16>
+HalfProjectionData<T16>::HalfProjectionData(const CTL::ProjectionData& projections)
+    : m_dims(projections.dimensions())
+    , m_data(viewSize() * m_dims.nbViews)
+{
+    auto dst = m_data.data();
+    for(const auto& view : projections.data())
+        for(const auto& module : view.data())
+        {
+            toHalfPrecision(module.rawData(), dst, module.nbElements());
+            dst += module.nbElements();
+        }
+}
+
+template <typename T16>
+CTL::ProjectionData HalfProjectionData<T16>::toProjectionData() const
+{
+    CTL::ProjectionData ret(m_dims.nbChannels, m_dims.nbRows, m_dims.nbModules);
+    for(uint viewNb = 0; viewNb < m_dims.nbViews; ++viewNb)
+        ret.append(view(viewNb));
+
+    return ret;
+}
+
+template <typename T16>
+CTL::SingleViewData HalfProjectionData<T16>::view(uint viewNb) const
+{
+    CTL::SingleViewData ret(m_dims.nbChannels, m_dims.nbRows);
+    ret.allocateMemory(m_dims.nbModules);
+
+    auto src = m_data.data() + viewNb * viewSize();
+    for(auto& module : ret.data())
+    {
+        toSinglePrecision(src, module.rawData(), module.nbElements());
+        src += module.nbElements();
+    }
+
+    return ret;
+}
+
+template <typename T16>
+void HalfProjectionData<T16>::setView(const CTL::SingleViewData& view, uint viewNb)
+{
+    auto dst = m_data.data() + viewNb * viewSize();
+    for(const auto& module : view.data())
+    {
+        toHalfPrecision(module.rawData(), dst, module.nbElements());
+        dst += module.nbElements();
+    }
+}
+
+template <typename T16>
+HalfVolume<T16>::HalfVolume(const CTL::VoxelVolume<float>& volume)
+    : m_dims(volume.dimensions())
+    , m_voxelSize(volume.voxelSize())
+    , m_offset(volume.offset())
+    , m_data(volume.totalVoxelCount())
+{
+    toHalfPrecision(volume.rawData(), m_data.data(), m_data.size());
+}
+
+template <typename T16>
+CTL::VoxelVolume<float> HalfVolume<T16>::toVoxelVolume() const
+{
+    auto ret = slab(0, m_dims.z);
+    ret.setVolumeOffset(m_offset);
+
+    return ret;
+}
+
+// fp32 copy of the slices [firstSlice, firstSlice + nbSlices)
+template <typename T16>
+CTL::VoxelVolume<float> HalfVolume<T16>::slab(uint firstSlice, uint nbSlices) const
+{
+    nbSlices = std::min(nbSlices, m_dims.z - std::min(firstSlice, m_dims.z));
+
+    std::vector<float> data(nbSlices * sliceSize());
+    toSinglePrecision(m_data.data() + firstSlice * sliceSize(), data.data(), data.size());
+
+    CTL::VoxelVolume<float> ret(m_dims.x, m_dims.y, nbSlices, m_voxelSize.x, m_voxelSize.y, m_voxelSize.z);
+    ret.setData(std::move(data));
+
+    return ret;
+}
+
+template <typename T16>
+void HalfVolume<T16>::setSlab(const CTL::VoxelVolume<float>& slab, uint firstSlice)
+{
+    const auto nbSlices = std::min(slab.dimensions().z, m_dims.z - std::min(firstSlice, m_dims.z));
+    toHalfPrecision(slab.rawData(), m_data.data() + firstSlice * sliceSize(), nbSlices * sliceSize());
+}
+
+#endif // HALFPRECISION_H
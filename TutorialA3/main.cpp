@@ -3,7 +3,10 @@
 #include "ctl.h"
 #include "ctl_qtgui.h"
 
+#include "halfprecision.h"
 #include "rawdataio.h"
+#include "streamingvolumefilter.h"
+#include "customvolumefilters.h"
 
 // helper
 void testSaveLoad(const CTL::ProjectionData& projections,
@@ -17,6 +20,8 @@ void testSaveLoad(const CTL::VoxelVolume<float>& volume,
 // implementations
 void tutorialA3_1();
 void tutorialA3_2();
+void tutorialA3_3();
+void tutorialA3_4();
 
 // ### NOTE ###
 // change this path to the folder where you placed the downloaded example files!
@@ -34,6 +39,8 @@ int main(int argc, char *argv[])
 
         tutorialA3_1();
         tutorialA3_2();
+        tutorialA3_3();
+        tutorialA3_4();
 
     }  catch (std::exception& err) {
         qCritical() << err.what();
@@ -98,6 +105,43 @@ void tutorialA3_2()
     testSaveLoad(V, ioVol.makeVolumeIO<float>());
 }
 
+void tutorialA3_3()
+{
+    // out-of-core filtering: the volume is processed slab by slab and never entirely held in memory
+    StreamingVolumeFilter<200, 200, 200, float> streamingFilter(32);
+    streamingFilter.addFilter(std::make_shared<MovingAverageFilter>(2), 2);
+    streamingFilter.addFilter(std::make_shared<MovingAverageFilter>(1, MovingAverageFilter::InPlace), 1);
+
+    const QString volumeFile = DATA_PATH + "volume.bin";
+    if(!streamingFilter.run(volumeFile, "volume_filtered.bin"))
+        return;
+
+    const auto ioVol = CTL::io::BaseTypeIO<RawDataIO<200, 200, 200, float>>();
+    CTL::gui::plot(ioVol.readVolume<float>("volume_filtered.bin"));
+}
+
+void tutorialA3_4()
+{
+    // 16 bit floating-point files (half the size of float files)
+    const auto V = CTL::VoxelVolume<float>::cube(200, 1.0f, 1.337f);
+    const auto ioHalf = CTL::io::BaseTypeIO<RawDataIO<200, 200, 200, Half>>();
+    testSaveLoad(V, ioHalf.makeVolumeIO<float>());
+
+    // 16 bit storage in memory, processing on an fp32 copy
+    HalfVolume<> halfVolume(V);
+    auto volume = halfVolume.toVoxelVolume();
+    MovingAverageFilter(1).filter(volume);
+    halfVolume.setSlab(volume, 0);
+    CTL::gui::plot(halfVolume.toVoxelVolume());
+
+    // accuracy of the storage types
+    auto P = CTL::ProjectionData(123, 45, 6); P.allocateMemory(7); P.fill(8.0f);
+    const HalfProjectionData<Half> halfProj(P);
+    const HalfProjectionData<BFloat16> bfloatProj(P);
+    qInfo() << "Half storage - difference: " << CTL::metric::RMSE(P.cbegin(), P.cend(), halfProj.data().cbegin());
+    qInfo() << "BFloat16 storage - difference: " << CTL::metric::RMSE(P.cbegin(), P.cend(), bfloatProj.data().cbegin());
+}
+
 // ##############
 // ### HELPER ###
 // ##############
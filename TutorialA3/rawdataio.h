@@ -5,8 +5,13 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QRect>
 #include <QVariantMap>
 
+#include <algorithm>
+
+// RawType: type of the values in the file, e.g. ushort, float or the 16 bit floating-point types
+// Half and BFloat16 (see halfprecision.h)
 template<uint dim1, uint dim2, uint dim3, typename RawType>
 class RawDataIO
 {
@@ -18,6 +23,18 @@ public:
     std::vector<T> readChunk(const QString& fileName, uint chunkNb) const;
     template <typename T>
     bool write(const std::vector<T>& data, const QVariantMap& metaInfo, const QString& fileName) const;
+
+    // range access for out-of-core processing (see StreamingVolumeFilter)
+    // -> readChunks() returns only the values actually read (e.g. fewer for a truncated file)
+    template <typename T>
+    std::vector<T> readChunks(const QString& fileName, uint firstChunk, uint nbChunks) const;
+    template <typename T>
+    bool writeChunks(const std::vector<T>& data, const QString& fileName, uint firstChunk) const;
+    // writes a rectangular region of 'nbChunks' chunks (e.g. the ROI of compacted projections,
+    // see RoiProjectionData); 'data' holds the region chunk by chunk, row-major within the region
+    template <typename T>
+    bool writeRegion(const T* data, const QRect& region, const QString& fileName, uint firstChunk,
+                     uint nbChunks) const;
 };
 
 
@@ -63,6 +80,14 @@ std::vector<T> RawDataIO<dim1, dim2, dim3, RawType>::readAll(const QString& file
 template<uint dim1, uint dim2, uint dim3, typename RawType>
 template<typename T>
 std::vector<T> RawDataIO<dim1, dim2, dim3, RawType>::readChunk(const QString &fileName, uint chunkNb) const
+{
+    return readChunks<T>(fileName, chunkNb, 1);
+}
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+template<typename T>
+std::vector<T> RawDataIO<dim1, dim2, dim3, RawType>::readChunks(const QString &fileName, uint firstChunk,
+                                                                uint nbChunks) const
 {
     QFile infile(fileName);
     if(!infile.open(QIODevice::ReadOnly))
@@ -71,14 +96,22 @@ std::vector<T> RawDataIO<dim1, dim2, dim3, RawType>::readChunk(const QString &fi
         return std::vector<T>();
     }
 
-    std::vector<RawType> rawValues(dim1 * dim2);
-    const auto numBytes = rawValues.size() * sizeof(RawType);
-    infile.skip(dim1 * dim2 * sizeof(RawType) * chunkNb);
+    const auto chunkSize = static_cast<qint64>(dim1) * dim2;
+    std::vector<RawType> rawValues(chunkSize * nbChunks);
+    const auto numBytes = static_cast<qint64>(rawValues.size() * sizeof(RawType));
+    if(!infile.seek(chunkSize * sizeof(RawType) * firstChunk))
+    {
+        qCritical() << "Could not seek to chunk" << firstChunk << "in file " << fileName;
+        return std::vector<T>();
+    }
     const auto bytesRead = infile.read(reinterpret_cast<char*>(rawValues.data()), numBytes);
     infile.close();
 
     if(numBytes != bytesRead)
+    {
         qWarning() << "Did not read the expected amount of data.";
+        rawValues.resize(std::max(bytesRead, qint64(0)) / sizeof(RawType));
+    }
 
     // conversion from RawType -> T
     std::vector<T> ret(rawValues.size());
@@ -115,6 +148,96 @@ bool RawDataIO<dim1, dim2, dim3, RawType>::write(const std::vector<T> &data, con
     return bytesWritten == numBytes;
 }
 
+// writes 'data' (an integer number of chunks) to the file starting at chunk 'firstChunk';
+// the remaining content of an existing file is preserved
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+template<typename T>
+bool RawDataIO<dim1, dim2, dim3, RawType>::writeChunks(const std::vector<T>& data, const QString& fileName,
+                                                       uint firstChunk) const
+{
+    QFile outfile(fileName);
+    if(!outfile.open(QIODevice::ReadWrite))
+    {
+        qCritical() << "Could not open file " << fileName << "for writing.";
+        return false;
+    }
+
+    const auto chunkSize = static_cast<qint64>(dim1) * dim2;
+    if(data.size() % chunkSize)
+        qWarning() << "Data to write does not consist of entire chunks.";
+
+    // convert input data into correct data type (T -> RawType)
+    std::vector<RawType> rawValues(data.size());
+    std::transform(data.cbegin(), data.cend(), rawValues.begin(),
+                   [] (const T& value) { return static_cast<RawType>(value); } );
+
+    // write the data
+    const auto numBytes = static_cast<qint64>(rawValues.size() * sizeof(RawType));
+    if(!outfile.seek(chunkSize * sizeof(RawType) * firstChunk))
+    {
+        qCritical() << "Could not seek to chunk" << firstChunk << "in file " << fileName;
+        return false;
+    }
+    const auto bytesWritten = outfile.write(reinterpret_cast<const char*>(rawValues.data()), numBytes);
+
+    outfile.close();
+
+    return bytesWritten == numBytes;
+}
+
+// only the rows of the region are written (one write per row), the file is extended to the full
+// size (dim1 * dim2 * dim3) if required; pixels outside of the region are not touched, i.e. they
+// are zero in a new file and preserved in an existing one
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+template<typename T>
+bool RawDataIO<dim1, dim2, dim3, RawType>::writeRegion(const T* data, const QRect& region, const QString& fileName,
+                                                       uint firstChunk, uint nbChunks) const
+{
+    if(!region.isEmpty() && !QRect(0, 0, dim1, dim2).contains(region))
+    {
+        qCritical() << "Region" << region << "exceeds the chunk size.";
+        return false;
+    }
+
+    QFile outfile(fileName);
+    if(!outfile.open(QIODevice::ReadWrite))
+    {
+        qCritical() << "Could not open file " << fileName << "for writing.";
+        return false;
+    }
+
+    const auto fileSize = static_cast<qint64>(size_t(dim1) * dim2 * dim3 * sizeof(RawType));
+    if(outfile.size() < fileSize && !outfile.resize(fileSize))
+    {
+        qCritical() << "Could not resize file " << fileName;
+        return false;
+    }
+    if(region.isEmpty())
+        return true;
+
+    const auto width = static_cast<size_t>(region.width());
+    const auto numBytes = static_cast<qint64>(width * sizeof(RawType));
+    std::vector<RawType> rawRow(width);
+    for(uint chunk = firstChunk; chunk < firstChunk + nbChunks; ++chunk)
+        for(int row = region.top(); row <= region.bottom(); ++row, data += width)
+        {
+            // convert input data into correct data type (T -> RawType)
+            std::transform(data, data + width, rawRow.begin(),
+                           [] (const T& value) { return static_cast<RawType>(value); } );
+
+            const auto offset = ((static_cast<qint64>(chunk) * dim2 + row) * dim1 + region.left()) * sizeof(RawType);
+            if(!outfile.seek(offset) || outfile.write(reinterpret_cast<const char*>(rawRow.data()), numBytes) != numBytes)
+            {
+                qCritical() << "Could not write chunk" << chunk << "to file " << fileName;
+                return false;
+            }
+        }
+
+    outfile.close();
+
+    return true;
+}
+
 
 
 #endif // RAWDATAIO_H
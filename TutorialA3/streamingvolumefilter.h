@@ -0,0 +1,156 @@
+#ifndef STREAMINGVOLUMEFILTER_H
+#define STREAMINGVOLUMEFILTER_H
+
+#include "rawdataio.h"
+
+#include "img/voxelvolume.h"
+#include "processing/abstractvolumefilter.h"
+
+#include <future>
+#include <memory>
+
+// StreamingVolumeFilter
+// out-of-core application of a chain of volume filters to a raw volume file (see RawDataIO):
+// the volume is processed in slabs of 'slabThickness' z-slices (plus the required halo slices)
+// -> reading the next slab, filtering the current one and writing the previous one overlap
+// -> peak memory is roughly 3 * (slabThickness + 2 * halo) slices
+// the halo of the chain is the sum of the halos of all filters (e.g. the radius of a
+// MovingAverageFilter); at the volume borders, each filter sees the original volume border
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+class StreamingVolumeFilter
+{
+public:
+    explicit StreamingVolumeFilter(uint slabThickness = 32,
+                                   const CTL::VoxelVolume<float>::VoxelSize& voxelSize = { 1.0f, 1.0f, 1.0f });
+
+    void addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter, uint halo = 0);
+    uint halo() const;
+
+    bool run(const QString& inputFileName, const QString& outputFileName) const;
+
+private:
+    struct Slab
+    {
+        uint firstSlice; // first slice to read (incl. lower halo)
+        uint nbLower;
+        uint nbInner;
+        uint nbUpper;
+
+        uint nbSlices() const { return nbLower + nbInner + nbUpper; }
+    };
+
+    Slab slab(uint slabNb) const;
+
+    std::vector<std::shared_ptr<CTL::AbstractVolumeFilter>> m_filters;
+    uint m_halo = 0;
+    uint m_slabThickness;
+    CTL::VoxelVolume<float>::VoxelSize m_voxelSize;
+};
+
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+StreamingVolumeFilter<dim1, dim2, dim3, RawType>::StreamingVolumeFilter(
+        uint slabThickness, const CTL::VoxelVolume<float>::VoxelSize& voxelSize)
+    : m_slabThickness(std::max(slabThickness, 1u))
+    , m_voxelSize(voxelSize)
+{
+}
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+void StreamingVolumeFilter<dim1, dim2, dim3, RawType>::addFilter(std::shared_ptr<CTL::AbstractVolumeFilter> filter,
+                                                                 uint halo)
+{
+    if(!filter)
+    {
+        qWarning() << "StreamingVolumeFilter: null filter ignored.";
+        return;
+    }
+
+    m_filters.push_back(std::move(filter));
+    m_halo += halo;
+}
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+uint StreamingVolumeFilter<dim1, dim2, dim3, RawType>::halo() const
+{
+    return m_halo;
+}
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+bool StreamingVolumeFilter<dim1, dim2, dim3, RawType>::run(const QString& inputFileName,
+                                                           const QString& outputFileName) const
+{
+    const RawDataIO<dim1, dim2, dim3, RawType> io;
+    const auto sliceSize = size_t(dim1) * dim2;
+    const auto nbSlabs = (dim3 + m_slabThickness - 1) / m_slabThickness;
+
+    QFile::remove(outputFileName);
+
+    const auto readSlab = [this, &io, &inputFileName] (uint slabNb) {
+        const auto s = slab(slabNb);
+        return io.template readChunks<float>(inputFileName, s.firstSlice, s.nbSlices());
+    };
+    const auto writeSlab = [&io, &outputFileName] (std::vector<float> data, uint firstSlice) {
+        return io.writeChunks(data, outputFileName, firstSlice);
+    };
+
+    auto nextSlab = std::async(std::launch::async, readSlab, 0u);
+    std::future<bool> pendingWrite;
+
+    for(uint slabNb = 0; slabNb < nbSlabs; ++slabNb)
+    {
+        const auto s = slab(slabNb);
+        auto data = nextSlab.get();
+        if(data.size() != s.nbSlices() * sliceSize)
+        {
+            qCritical() << "StreamingVolumeFilter: could not read slab" << slabNb << "from" << inputFileName;
+            return false;
+        }
+
+        if(slabNb + 1 < nbSlabs)
+            nextSlab = std::async(std::launch::async, readSlab, slabNb + 1);
+
+        CTL::VoxelVolume<float> volume(dim1, dim2, s.nbSlices(), m_voxelSize.x, m_voxelSize.y, m_voxelSize.z);
+        volume.setData(std::move(data));
+        for(const auto& filter : m_filters)
+            filter->filter(volume);
+
+        // strip the halo slices (in place, no additional memory)
+        auto result = std::move(volume.data());
+        result.erase(result.end() - s.nbUpper * sliceSize, result.end());
+        result.erase(result.begin(), result.begin() + s.nbLower * sliceSize);
+
+        if(pendingWrite.valid() && !pendingWrite.get())
+        {
+            qCritical() << "StreamingVolumeFilter: could not write to" << outputFileName;
+            return false;
+        }
+        pendingWrite = std::async(std::launch::async, writeSlab, std::move(result), s.firstSlice + s.nbLower);
+    }
+
+    if(pendingWrite.valid() && !pendingWrite.get())
+    {
+        qCritical() << "StreamingVolumeFilter: could not write to" << outputFileName;
+        return false;
+    }
+
+    return true;
+}
+
+template<uint dim1, uint dim2, uint dim3, typename RawType>
+typename StreamingVolumeFilter<dim1, dim2, dim3, RawType>::Slab
+StreamingVolumeFilter<dim1, dim2, dim3, RawType>::slab(uint slabNb) const
+{
+    const auto begin = slabNb * m_slabThickness;
+    const auto end = std::min(begin + m_slabThickness, dim3);
+
+    Slab ret;
+    ret.nbLower = std::min(m_halo, begin);
+    ret.nbInner = end - begin;
+    ret.nbUpper = std::min(m_halo, dim3 - end);
+    ret.firstSlice = begin - ret.nbLower;
+
+    return ret;
+}
+
+#endif // STREAMINGVOLUMEFILTER_H
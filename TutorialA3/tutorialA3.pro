@@ -8,7 +8,11 @@ CONFIG -= app_bundle
 include(../../ctl/modules/ctl.pri)
 include(../../ctl/modules/ctl_qtgui.pri)
 
+INCLUDEPATH += ../TutorialA2
+
 SOURCES += \
+        ../TutorialA2/batchdatamodel.cpp \
+        ../TutorialA2/customvolumefilters.cpp \
         main.cpp
 
 # Default rules for deployment.
@@ -17,4 +21,8 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
-    rawdataio.h
+    ../TutorialA2/batchdatamodel.h \
+    ../TutorialA2/customvolumefilters.h \
+    halfprecision.h \
+    rawdataio.h \
+    streamingvolumefilter.h
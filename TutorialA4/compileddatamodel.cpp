@@ -0,0 +1,213 @@
+#include "compileddatamodel.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+const uint NB_SAMPLES = 4096;         // sampling of [from, to] used to detect steps
+const uint INITIAL_LUT_SIZE = 1024;
+const uint MAX_LUT_SIZE = 1u << 22;
+
+// index of the first element in 'sorted' that is greater than 'x' (same as std::upper_bound);
+// the loop has a fixed trip count and no data-dependent branches
+size_t upperBoundIndex(const std::vector<float>& sorted, float x)
+{
+    if(sorted.empty())
+        return 0;
+
+    auto base = sorted.data();
+    auto n = sorted.size();
+    while(n > 1)
+    {
+        const auto half = n / 2;
+        base = (base[half] <= x) ? base + half : base;
+        n -= half;
+    }
+
+    return static_cast<size_t>(base - sorted.data()) + (*base <= x ? 1 : 0);
+}
+
+// 'nbCells' + 1 equidistant positions from 'from' to 'to'
+std::vector<float> samplePositions(float from, float to, uint nbCells)
+{
+    const auto spacing = (double(to) - double(from)) / nbCells;
+
+    std::vector<float> ret(nbCells + 1);
+    for(uint i = 0; i < nbCells; ++i)
+        ret[i] = static_cast<float>(from + i * spacing);
+    ret[nbCells] = to;
+
+    return ret;
+}
+
+} // unnamed namespace
+
+CompiledDataModel::CompiledDataModel(std::shared_ptr<CTL::AbstractDataModel> model, float from, float to,
+                                     float tolerance)
+    : m_source(std::move(model))
+    , m_from(from)
+    , m_to(to)
+{
+    if(!m_source)
+        throw std::runtime_error("CompiledDataModel: no model to compile.");
+    if(!(from < to))
+        throw std::domain_error("CompiledDataModel: invalid range [from, to].");
+
+    if(!compileIntervalTable())
+        compileLookupTable(tolerance);
+}
+
+float CompiledDataModel::valueAt(float position) const
+{
+    if(position >= m_from && position <= m_to)
+        return tableValueAt(position);
+
+    return m_source->valueAt(position);
+}
+
+CTL::AbstractDataModel* CompiledDataModel::clone() const
+{
+    return new CompiledDataModel(*this);
+}
+
+void CompiledDataModel::valuesAt(const float* positions, float* values, size_t count) const
+{
+    for(size_t i = 0; i < count; ++i)
+        values[i] = CompiledDataModel::valueAt(positions[i]);
+}
+
+bool CompiledDataModel::isIntervalTable() const
+{
+    return m_isIntervalTable;
+}
+
+size_t CompiledDataModel::tableSize() const
+{
+    return m_isIntervalTable ? m_values.size() : m_lut.size();
+}
+
+float CompiledDataModel::maxDeviation() const
+{
+    return m_maxDeviation;
+}
+
+QVariant CompiledDataModel::toVariant() const
+{
+    return m_source->toVariant();
+}
+
+bool CompiledDataModel::compileIntervalTable()
+{
+    const auto positions = samplePositions(m_from, m_to, NB_SAMPLES);
+    std::vector<float> samples(positions.size());
+    evaluateBatch(*m_source, positions.data(), samples.data(), positions.size());
+
+    if(std::any_of(samples.cbegin(), samples.cend(), [] (float value) { return std::isnan(value); }))
+        return false;
+
+    // a piecewise-constant model changes its value between a few neighboring samples only
+    uint nbChanges = 0;
+    for(uint i = 0; i < NB_SAMPLES; ++i)
+        if(samples[i] != samples[i + 1])
+            ++nbChanges;
+    if(nbChanges > NB_SAMPLES / 16)
+        return false;
+
+    m_steps.clear();
+    m_values.assign(1, samples.front());
+    for(uint i = 0; i < NB_SAMPLES; ++i)
+        if(samples[i] != samples[i + 1])
+            locateSteps(positions[i], samples[i], positions[i + 1], samples[i + 1]);
+
+    // verify that the model is constant in between the sample positions
+    std::vector<float> probes(NB_SAMPLES);
+    for(uint i = 0; i < NB_SAMPLES; ++i)
+        probes[i] = positions[i] + 0.5f * (positions[i + 1] - positions[i]);
+    std::vector<float> probeValues(NB_SAMPLES);
+    evaluateBatch(*m_source, probes.data(), probeValues.data(), NB_SAMPLES);
+
+    for(uint i = 0; i < NB_SAMPLES; ++i)
+        if(m_values[upperBoundIndex(m_steps, probes[i])] != probeValues[i])
+        {
+            m_steps.clear();
+            m_values.clear();
+            return false;
+        }
+
+    m_isIntervalTable = true;
+    m_maxDeviation = 0.0f;
+    return true;
+}
+
+// bisection down to adjacent floating-point numbers; intermediate values (i.e. narrow intervals
+// in between 'lower' and 'upper') are resolved recursively
+void CompiledDataModel::locateSteps(float lower, float lowerValue, float upper, float upperValue)
+{
+    const auto mid = lower + 0.5f * (upper - lower);
+    if(mid <= lower || mid >= upper)
+    {
+        m_steps.push_back(upper);
+        m_values.push_back(upperValue);
+        return;
+    }
+
+    const auto midValue = m_source->valueAt(mid);
+    if(midValue != lowerValue)
+        locateSteps(lower, lowerValue, mid, midValue);
+    if(midValue != upperValue)
+        locateSteps(mid, midValue, upper, upperValue);
+}
+
+void CompiledDataModel::compileLookupTable(float tolerance)
+{
+    for(auto nbCells = INITIAL_LUT_SIZE; ; nbCells *= 2)
+    {
+        const auto positions = samplePositions(m_from, m_to, nbCells);
+        m_lut.resize(positions.size());
+        evaluateBatch(*m_source, positions.data(), m_lut.data(), positions.size());
+        m_invSpacing = static_cast<float>(nbCells / (double(m_to) - double(m_from)));
+
+        // probe each cell at 1/4, 1/2 and 3/4 of its width (an estimate of the maximum deviation:
+        // features of the model in between the probes are not detected)
+        std::vector<float> probes(3 * size_t(nbCells));
+        for(uint i = 0; i < nbCells; ++i)
+            for(uint q = 0; q < 3; ++q)
+                probes[3 * i + q] = positions[i] + 0.25f * (q + 1) * (positions[i + 1] - positions[i]);
+        std::vector<float> probeValues(probes.size());
+        evaluateBatch(*m_source, probes.data(), probeValues.data(), probes.size());
+
+        m_maxDeviation = 0.0f;
+        for(size_t p = 0; p < probes.size(); ++p)
+        {
+            const auto deviation = std::fabs(tableValueAt(probes[p]) - probeValues[p]);
+            if(!(deviation <= m_maxDeviation))
+                m_maxDeviation = deviation;
+        }
+
+        if(m_maxDeviation <= tolerance)
+            return;
+
+        if(nbCells >= MAX_LUT_SIZE)
+        {
+            qWarning() << "CompiledDataModel: requested tolerance" << tolerance << "not reached "
+                          "(maximum deviation:" << m_maxDeviation << ").";
+            return;
+        }
+    }
+}
+
+float CompiledDataModel::tableValueAt(float position) const
+{
+    if(m_isIntervalTable)
+        return m_values[upperBoundIndex(m_steps, position)];
+
+    const auto t = (position - m_from) * m_invSpacing;
+    const auto cell = std::min(static_cast<size_t>(t), m_lut.size() - 2);
+    const auto frac = t - static_cast<float>(cell);
+
+    return m_lut[cell] + frac * (m_lut[cell + 1] - m_lut[cell]);
+}
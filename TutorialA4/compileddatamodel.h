@@ -0,0 +1,63 @@
+#ifndef COMPILEDDATAMODEL_H
+#define COMPILEDDATAMODEL_H
+
+#include "batchdatamodel.h"
+
+// CompiledDataModel
+// flat representation of an arbitrary (e.g. composed) data model within the range [from, to]:
+// -> piecewise-constant models (such as sums of ConstantModel and RectFunctionModel) become a
+//    sorted interval table with the exact step positions -> O(log n) per sample
+// -> all other models become a uniform lookup table (linear interpolation) that is refined until
+//    the deviation from the original model at all probe positions (1/4, 1/2 and 3/4 of each cell)
+//    is within 'tolerance' -> O(1); 'tolerance' is thus an estimated error bound, not a guaranteed
+//    one (the model is not known in between the probes, e.g. a narrow peak may be missed)
+// positions outside [from, to] are passed to the original model
+// features narrower than (to - from) / 4096 can only be resolved if they touch a sample position
+//
+// de-/serialization: a compiled model is stored as its original model, i.e. the serialized
+// form does not change and deserialization yields the (uncompiled) original model
+class CompiledDataModel : public AbstractBatchDataModel
+{
+    CTL_TYPE_ID(CTL::AbstractDataModel::UserType + 40)
+
+public:
+    CompiledDataModel(std::shared_ptr<CTL::AbstractDataModel> model, float from, float to,
+                      float tolerance = 1.0e-4f);
+
+    // AbstractDataModel interface
+    float valueAt(float position) const override;
+    CTL::AbstractDataModel* clone() const override;
+
+    // AbstractBatchDataModel interface
+    void valuesAt(const float* positions, float* values, size_t count) const override;
+
+    bool isIntervalTable() const;
+    size_t tableSize() const;
+    float maxDeviation() const; // largest deviation found at the probe positions (estimate)
+
+    // de-/serialization
+    QVariant toVariant() const override;
+
+private:
+    bool compileIntervalTable();
+    void compileLookupTable(float tolerance);
+    void locateSteps(float lower, float lowerValue, float upper, float upperValue);
+    float tableValueAt(float position) const;
+
+    std::shared_ptr<CTL::AbstractDataModel> m_source;
+    float m_from;
+    float m_to;
+
+    // interval table: m_values[i] holds for [m_steps[i-1], m_steps[i])
+    std::vector<float> m_steps;
+    std::vector<float> m_values;
+
+    // uniform lookup table
+    std::vector<float> m_lut;
+    float m_invSpacing = 0.0f;
+
+    bool m_isIntervalTable = false;
+    float m_maxDeviation = 0.0f;
+};
+
+#endif // COMPILEDDATAMODEL_H
@@ -1,9 +1,166 @@
 #include "custommodels.h"
 #include "io/serializationhelper.h"
 
+// AVX2/AVX-512 code paths are compiled for their instruction set only (target attribute or
+// intrinsics on MSVC), the remaining code needs no specific instruction set; the path is selected
+// at run time depending on the CPU (see instructionSet())
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CUSTOMMODELS_SIMD
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define CUSTOMMODELS_SIMD
+#define TARGET_AVX2
+#define TARGET_AVX512
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
 DECLARE_SERIALIZABLE_TYPE(QuadraticFunctionModel)
 DECLARE_SERIALIZABLE_TYPE(DiscretizingModel)
 
+namespace {
+
+#if defined(CUSTOMMODELS_SIMD)
+
+enum class InstructionSet { Scalar, AVX2, AVX512 };
+
+// widest instruction set supported by the CPU and enabled by the OS (detected once)
+InstructionSet instructionSet()
+{
+    static const auto ret = [] () -> InstructionSet {
+#if defined(__GNUC__)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f"))
+            return InstructionSet::AVX512;
+        if(__builtin_cpu_supports("avx2"))
+            return InstructionSet::AVX2;
+#else
+        int info[4];
+        __cpuid(info, 0);
+        const auto maxLeaf = info[0];
+        __cpuid(info, 1);
+        const auto osxsaveAndAvx = (1 << 27) | (1 << 28);
+        if(maxLeaf >= 7 && (info[2] & osxsaveAndAvx) == osxsaveAndAvx)
+        {
+            const auto xcr0 = _xgetbv(0); // register state saved by the OS
+            __cpuidex(info, 7, 0);
+            if((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+                return InstructionSet::AVX512;
+            if((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+                return InstructionSet::AVX2;
+        }
+#endif
+        return InstructionSet::Scalar;
+    }();
+
+    return ret;
+}
+
+// the following kernels process full vectors only and return the number of processed elements;
+// same operation order as the scalar versions, i.e. identical results
+// (the *_round_ps products in the AVX-512 kernels prevent the compiler from contracting them with
+// the subsequent additions to FMA instructions, which are part of AVX-512F)
+
+TARGET_AVX512 size_t quadraticAVX512(float a, float b, float c, const float* positions, float* values,
+                                     size_t count)
+{
+    const auto va = _mm512_set1_ps(a);
+    const auto vb = _mm512_set1_ps(b);
+    const auto vc = _mm512_set1_ps(c);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        const auto x = _mm512_loadu_ps(positions + i);
+        const auto ax2 = _mm512_mul_round_ps(_mm512_mul_ps(va, x), x, _MM_FROUND_CUR_DIRECTION);
+        const auto bx = _mm512_mul_round_ps(vb, x, _MM_FROUND_CUR_DIRECTION);
+        _mm512_storeu_ps(values + i, _mm512_add_ps(_mm512_add_ps(ax2, bx), vc));
+    }
+    return i;
+}
+
+TARGET_AVX2 size_t quadraticAVX2(float a, float b, float c, const float* positions, float* values,
+                                 size_t count)
+{
+    const auto va = _mm256_set1_ps(a);
+    const auto vb = _mm256_set1_ps(b);
+    const auto vc = _mm256_set1_ps(c);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const auto x = _mm256_loadu_ps(positions + i);
+        const auto ax2 = _mm256_mul_ps(_mm256_mul_ps(va, x), x);
+        _mm256_storeu_ps(values + i, _mm256_add_ps(_mm256_add_ps(ax2, _mm256_mul_ps(vb, x)), vc));
+    }
+    return i;
+}
+
+// floor(diff / step) * step in double precision, rounded to float
+TARGET_AVX512 __m256 quantizeAVX512(__m256 diff, __m512d step)
+{
+    const auto binIndex = _mm512_roundscale_pd(_mm512_div_pd(_mm512_cvtps_pd(diff), step), _MM_FROUND_TO_NEG_INF);
+    return _mm512_cvtpd_ps(_mm512_mul_pd(binIndex, step));
+}
+
+TARGET_AVX512 size_t discretizeAVX512(float minValue, float maxValue, double stepwidth,
+                                      const float* positions, float* values, size_t count)
+{
+    const auto minVal = _mm512_set1_ps(minValue);
+    const auto maxVal = _mm512_set1_ps(maxValue);
+    const auto step = _mm512_set1_pd(stepwidth);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        const auto x = _mm512_loadu_ps(positions + i);
+        const auto diff = _mm512_castps_pd(_mm512_sub_ps(x, minVal));
+        const auto lower = quantizeAVX512(_mm256_castpd_ps(_mm512_castpd512_pd256(diff)), step);
+        const auto upper = quantizeAVX512(_mm256_castpd_ps(_mm512_extractf64x4_pd(diff, 1)), step);
+        const auto joined = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(lower)),
+                                               _mm256_castps_pd(upper), 1);
+        auto y = _mm512_add_ps(_mm512_castpd_ps(joined), minVal);
+
+        // border cases
+        y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, minVal, _CMP_LT_OQ), y, minVal);
+        y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, maxVal, _CMP_GT_OQ), y, maxVal);
+        _mm512_storeu_ps(values + i, y);
+    }
+    return i;
+}
+
+TARGET_AVX2 __m128 quantizeAVX2(__m128 diff, __m256d step)
+{
+    const auto binIndex = _mm256_floor_pd(_mm256_div_pd(_mm256_cvtps_pd(diff), step));
+    return _mm256_cvtpd_ps(_mm256_mul_pd(binIndex, step));
+}
+
+TARGET_AVX2 size_t discretizeAVX2(float minValue, float maxValue, double stepwidth,
+                                  const float* positions, float* values, size_t count)
+{
+    const auto minVal = _mm256_set1_ps(minValue);
+    const auto maxVal = _mm256_set1_ps(maxValue);
+    const auto step = _mm256_set1_pd(stepwidth);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const auto x = _mm256_loadu_ps(positions + i);
+        const auto diff = _mm256_sub_ps(x, minVal);
+        const auto lower = quantizeAVX2(_mm256_castps256_ps128(diff), step);
+        const auto upper = quantizeAVX2(_mm256_extractf128_ps(diff, 1), step);
+        auto y = _mm256_add_ps(_mm256_insertf128_ps(_mm256_castps128_ps256(lower), upper, 1), minVal);
+
+        // border cases
+        y = _mm256_blendv_ps(y, minVal, _mm256_cmp_ps(x, minVal, _CMP_LT_OQ));
+        y = _mm256_blendv_ps(y, maxVal, _mm256_cmp_ps(x, maxVal, _CMP_GT_OQ));
+        _mm256_storeu_ps(values + i, y);
+    }
+    return i;
+}
+
+#endif // CUSTOMMODELS_SIMD
+
+} // unnamed namespace
+
 QuadraticFunctionModel::QuadraticFunctionModel(float a, float b, float c)
     : m_a(a)
     , m_b(b)
@@ -16,6 +173,25 @@ float QuadraticFunctionModel::valueAt(float position) const
     return m_a * position * position + m_b * position + m_c;
 }
 
+// vectorized evaluation (AVX-512 or AVX2, depending on the CPU); identical results as valueAt()
+void QuadraticFunctionModel::valuesAt(const float* positions, float* values, size_t count) const
+{
+    size_t i = 0;
+
+#if defined(CUSTOMMODELS_SIMD)
+    switch(instructionSet())
+    {
+    case InstructionSet::AVX512: i = quadraticAVX512(m_a, m_b, m_c, positions, values, count); break;
+    case InstructionSet::AVX2:   i = quadraticAVX2(m_a, m_b, m_c, positions, values, count); break;
+    case InstructionSet::Scalar: break;
+    }
+#endif
+
+    // remainder (or all elements if the CPU supports neither AVX2 nor AVX-512)
+    for(; i < count; ++i)
+        values[i] = m_a * positions[i] * positions[i] + m_b * positions[i] + m_c;
+}
+
 CTL::AbstractDataModel* QuadraticFunctionModel::clone() const
 {
     return new QuadraticFunctionModel(*this);
@@ -69,6 +245,32 @@ float DiscretizingModel::valueAt(float position) const
     return static_cast<float>(binIndex * stepwidth) + m_minValue;
 }
 
+// vectorized evaluation (AVX-512 or AVX2, depending on the CPU); computes the bins in double
+// precision as valueAt() does
+void DiscretizingModel::valuesAt(const float* positions, float* values, size_t count) const
+{
+    size_t i = 0;
+
+#if defined(CUSTOMMODELS_SIMD)
+    const auto stepwidth = (m_maxValue - m_minValue) / double(m_nbValues);
+    switch(instructionSet())
+    {
+    case InstructionSet::AVX512:
+        i = discretizeAVX512(m_minValue, m_maxValue, stepwidth, positions, values, count);
+        break;
+    case InstructionSet::AVX2:
+        i = discretizeAVX2(m_minValue, m_maxValue, stepwidth, positions, values, count);
+        break;
+    case InstructionSet::Scalar:
+        break;
+    }
+#endif
+
+    // remainder (or all elements if the CPU supports neither AVX2 nor AVX-512)
+    for(; i < count; ++i)
+        values[i] = DiscretizingModel::valueAt(positions[i]);
+}
+
 CTL::AbstractDataModel* DiscretizingModel::clone() const
 {
     return new DiscretizingModel(*this);
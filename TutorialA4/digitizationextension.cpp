@@ -25,8 +25,12 @@ CTL::ProjectionData DigitizationExtension::extendedProject(const MetaProjector&
 
     // process the data
     auto model = std::make_shared<DiscretizingModel>(0.0f, m_maxValue, std::pow(2.0f, static_cast<float>(m_bitDepth)));
-    for(auto& pix : projections)
-        pix = model->valueAt(pix);
+    for(auto& view : projections.data())
+        for(auto& module : view.data())
+        {
+            auto& pixels = module.data();
+            model->valuesAt(pixels.data(), pixels.data(), pixels.size());
+        }
 
     return projections;
 }
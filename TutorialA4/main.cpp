@@ -4,6 +4,7 @@
 #include "ctl_ocl.h"
 #include "ctl_qtgui.h"
 
+#include "compileddatamodel.h"
 #include "custommodels.h"           // see Tutorial A1
 #include "customvolumefilters.h"    // see Tutorial A2
 #include "digitizationextension.h"
@@ -135,7 +136,8 @@ CTL::VoxelVolume<float> phantom()
     model += std::make_shared<CTL::RectFunctionModel>(2.5f, 3.5f, 35.0f);
     model += std::make_shared<CTL::RectFunctionModel>(8.5f, 9.5f, 100.0f);
 
-    ModelApplicationFilter(model).filter(volumeBrain);
+    // evaluate the sum of models through a flat interval table (see compileddatamodel.h)
+    ModelApplicationFilter(std::make_shared<CompiledDataModel>(model, 0.0f, 10.0f)).filter(volumeBrain);
 
     auto volume = volumeBrain + volumeSkull;
     volume.setVoxelSize(1.0f);
@@ -10,6 +10,8 @@ include(../../ctl/modules/ctl_ocl.pri)
 include(../../ctl/modules/ctl_qtgui.pri)
 
 SOURCES += \
+        batchdatamodel.cpp \
+        compileddatamodel.cpp \
         custommodels.cpp \
         customvolumefilters.cpp \
         digitizationextension.cpp \
@@ -22,6 +24,8 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    batchdatamodel.h \
+    compileddatamodel.h \
     custommodels.h \
     customvolumefilters.h \
     digitizationextension.h \